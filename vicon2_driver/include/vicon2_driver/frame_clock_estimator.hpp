@@ -0,0 +1,83 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__FRAME_CLOCK_ESTIMATOR_HPP_
+#define VICON2_DRIVER__FRAME_CLOCK_ESTIMATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Online estimation of the mapping between the hardware frame number of the Vicon system
+// and the host clock: host_time = offset + frame * period.
+// The line is fitted by least squares over a sliding window of (frame, host time) samples.
+// Samples whose residual is above outlier_threshold times the robust (MAD based) deviation of
+// the window are rejected, so late wake-ups of the host do not bend the line. The fit restarts
+// when the frame numbers go back, when the period fitted over a full window drifts more than
+// max_drift_ppm from the nominal one, or when too many samples in a row are rejected
+// (host clock step).
+class FrameClockEstimator
+{
+public:
+  explicit FrameClockEstimator(
+    size_t window_size = 500, double outlier_threshold = 4.0, double max_drift_ppm = 1000.0);
+
+  void reset();
+  void set_nominal_rate(double rate_hz);
+
+  // Returns false if the sample was rejected as an outlier
+  bool add_sample(uint64_t hardware_frame, int64_t host_time_ns);
+
+  // Host time of a hardware frame according to the current fit
+  int64_t stamp(uint64_t hardware_frame) const;
+
+  bool is_valid() const;
+  size_t sample_count() const {return frames_.size();}
+  double period() const {return period_;}
+  double drift_ppm() const;
+  double rms_residual() const {return rms_residual_;}
+  double max_residual() const {return max_residual_;}
+  double last_residual() const {return last_residual_;}
+  unsigned int rejected_count() const {return rejected_count_;}
+  unsigned int reset_count() const {return reset_count_;}
+
+private:
+  void fit();
+  double robust_sigma() const;
+
+  size_t window_size_;
+  double outlier_threshold_;
+  double max_drift_ppm_;
+  double nominal_period_;
+
+  // Samples relative to the first one, stored in a ring buffer
+  uint64_t ref_frame_;
+  int64_t ref_time_ns_;
+  std::vector<double> frames_;
+  std::vector<double> times_;
+  size_t next_;
+  uint64_t last_frame_;
+  mutable std::vector<double> residuals_;
+
+  double offset_;
+  double period_;
+  double rms_residual_;
+  double max_residual_;
+  double last_residual_;
+  unsigned int consecutive_rejections_;
+  unsigned int rejected_count_;
+  unsigned int reset_count_;
+};
+
+#endif  // VICON2_DRIVER__FRAME_CLOCK_ESTIMATOR_HPP_
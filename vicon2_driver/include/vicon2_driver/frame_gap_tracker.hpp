@@ -0,0 +1,87 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__FRAME_GAP_TRACKER_HPP_
+#define VICON2_DRIVER__FRAME_GAP_TRACKER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Frame number continuity of the received frames.
+// A jump of n frame numbers counts n - 1 dropped frames. Frame numbers going back or jumping
+// more than max_gap frames are taken as a reset of the counter (server restart, new server)
+// and do not count as drops; neither does the first frame after break_continuity().
+class FrameGapTracker
+{
+public:
+  enum Result {FIRST, NEXT, GAP, DUPLICATE, RESET};
+
+  // Gap lengths 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64, >64
+  static const size_t kHistogramBins = 8;
+
+  explicit FrameGapTracker(uint32_t max_gap = 10000);
+
+  // Sliding windows, in received frames, over which drop rates are computed
+  void set_window_sizes(const std::vector<size_t> & sizes);
+
+  Result update(uint32_t frame_number);
+  void break_continuity() {has_last_ = false;}
+
+  uint32_t last_frame_number() const {return last_frame_number_;}
+  uint32_t last_dropped() const {return last_dropped_;}
+  uint64_t received() const {return received_;}
+  uint64_t expected() const {return expected_;}
+  uint64_t dropped() const {return dropped_;}
+  uint64_t gaps() const {return gaps_;}
+  uint64_t resets() const {return resets_;}
+  uint64_t duplicates() const {return duplicates_;}
+  double drop_pct() const;
+
+  size_t window_count() const {return windows_.size();}
+  size_t window_size(size_t i) const {return windows_[i].dropped.size();}
+  bool window_full(size_t i) const {return windows_[i].filled == windows_[i].dropped.size();}
+  double window_drop_pct(size_t i) const;
+
+  const std::array<uint64_t, kHistogramBins> & gap_histogram() const {return histogram_;}
+  static std::string histogram_label(size_t bin);
+
+private:
+  struct Window
+  {
+    std::vector<uint32_t> dropped;
+    size_t next;
+    size_t filled;
+    uint64_t sum;
+  };
+
+  void push(uint32_t dropped);
+
+  uint32_t max_gap_;
+  bool has_last_;
+  uint32_t last_frame_number_;
+  uint32_t last_dropped_;
+  uint64_t received_;
+  uint64_t expected_;
+  uint64_t dropped_;
+  uint64_t gaps_;
+  uint64_t resets_;
+  uint64_t duplicates_;
+  std::vector<Window> windows_;
+  std::array<uint64_t, kHistogramBins> histogram_;
+};
+
+#endif  // VICON2_DRIVER__FRAME_GAP_TRACKER_HPP_
@@ -0,0 +1,295 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__LABELED_MARKER_INDEX_HPP_
+#define VICON2_DRIVER__LABELED_MARKER_INDEX_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mocap_msgs/msg/marker.hpp"
+
+#include "DataStreamClient.h"
+
+// Reads the labeled markers of the subjects by index.
+// Reading them by name takes GetMarkerName, GetMarkerParentName and GetMarkerGlobalTranslation,
+// all string lookups, for every marker of every frame. Here the names are resolved once per
+// topology (subject names and marker counts) and the positions are then read with
+// GetLabeledMarkerGlobalTranslation. The SDK does not tell which subject marker a labeled
+// marker id is, so the ids are bound by matching the positions of both lists in a frame read by
+// name, within kBindTolerance as they come from different calls. A frame with an id not bound
+// yet (e.g. a marker occluded when resolving) is read by name again. unbound() tells how many
+// visible markers found no id; then the frames are read by name, without resolving again,
+// until the topology changes.
+// ClientT is ViconDataStreamSDK::CPP::Client, or a fake one in the tests.
+class LabeledMarkerIndex
+{
+public:
+  // Largest difference (mm) of a coordinate between both lists for the same marker
+  static constexpr double kBindTolerance = 1e-6;
+
+  LabeledMarkerIndex()
+  : valid_(false),
+    stale_(false),
+    by_name_only_(false),
+    resolutions_(0),
+    unbound_(0)
+  {}
+
+  // Forgets the topology, e.g. after connecting to another server
+  void reset()
+  {
+    valid_ = false;
+    stale_ = false;
+    by_name_only_ = false;
+    subject_names_.clear();
+    marker_counts_.clear();
+    slots_.clear();
+  }
+
+  // Appends the labeled markers of the current frame to markers, by subject and marker order.
+  // Occluded markers have their position zeroed. Returns false if they had to be read by name.
+  template<typename ClientT>
+  bool read(const ClientT & client, std::vector<mocap_msgs::msg::Marker> & markers)
+  {
+    bool same = update_topology(client);
+    if (same && by_name_only_) {
+      read_by_name(client, markers);
+      return false;
+    }
+    if (!same || !valid_ || stale_) {
+      resolve(client, markers);
+      return false;
+    }
+    return read_bound(client, markers);
+  }
+
+  // Checks the topology of the current frame and binds the marker ids if needed, for the
+  // readers that only use slot(). Returns false if the names had to be read, then the labeled
+  // markers read by name are appended to markers.
+  template<typename ClientT>
+  bool bind(const ClientT & client, std::vector<mocap_msgs::msg::Marker> & markers)
+  {
+    bool same = update_topology(client);
+    if (same && by_name_only_) {
+      read_by_name(client, markers);
+      return false;
+    }
+    if (same && valid_ && !stale_) {
+      return true;
+    }
+    resolve(client, markers);
+    return false;
+  }
+
+  template<typename ClientT>
+  bool bind(const ClientT & client)
+  {
+    std::vector<mocap_msgs::msg::Marker> markers;
+    return bind(client, markers);
+  }
+
+  // Position of a labeled marker id in subject and marker order, -1 if not bound. An id not
+  // bound has the markers resolved again with the next bind() or read().
+  int slot(unsigned int marker_id)
+  {
+    auto slot = slots_.find(marker_id);
+    if (slot == slots_.end()) {
+      stale_ = true;
+      return -1;
+    }
+    return static_cast<int>(slot->second);
+  }
+
+  // Labeled markers of the subjects
+  size_t size() const {return occluded_markers_.size();}
+
+  // Appends the labeled markers of the current frame to markers with the by-name calls
+  template<typename ClientT>
+  static void read_by_name(const ClientT & client, std::vector<mocap_msgs::msg::Marker> & markers)
+  {
+    unsigned int SubjectCount = client.GetSubjectCount().SubjectCount;
+    for (unsigned int SubjectIndex = 0; SubjectIndex < SubjectCount; ++SubjectIndex) {
+      std::string subject_name = client.GetSubjectName(SubjectIndex).SubjectName;
+      unsigned int MarkerCount = client.GetMarkerCount(subject_name).MarkerCount;
+      for (unsigned int MarkerIndex = 0; MarkerIndex < MarkerCount; ++MarkerIndex) {
+        mocap_msgs::msg::Marker marker;
+        marker.marker_name = client.GetMarkerName(subject_name, MarkerIndex).MarkerName;
+        marker.subject_name = subject_name;
+        marker.segment_name =
+          client.GetMarkerParentName(subject_name, marker.marker_name).SegmentName;
+
+        ViconDataStreamSDK::CPP::Output_GetMarkerGlobalTranslation OutputTranslation =
+          client.GetMarkerGlobalTranslation(subject_name, marker.marker_name);
+        marker.translation.x = OutputTranslation.Translation[0];
+        marker.translation.y = OutputTranslation.Translation[1];
+        marker.translation.z = OutputTranslation.Translation[2];
+        marker.occluded = OutputTranslation.Occluded;
+        markers.push_back(marker);
+      }
+    }
+  }
+
+  // Number of times the names were read again to bind the marker ids
+  uint64_t resolutions() const {return resolutions_;}
+
+  // Visible markers of the last resolution without a labeled marker id at their position
+  size_t unbound() const {return unbound_;}
+
+private:
+  // Reads the positions by index, falling back to resolve() on an id not bound yet
+  template<typename ClientT>
+  bool read_bound(const ClientT & client, std::vector<mocap_msgs::msg::Marker> & markers)
+  {
+    size_t first = markers.size();
+    markers.insert(markers.end(), occluded_markers_.begin(), occluded_markers_.end());
+    unsigned int LabeledMarkerCount = client.GetLabeledMarkerCount().MarkerCount;
+    for (unsigned int MarkerIndex = 0; MarkerIndex < LabeledMarkerCount; ++MarkerIndex) {
+      ViconDataStreamSDK::CPP::Output_GetLabeledMarkerGlobalTranslation OutputTranslation =
+        client.GetLabeledMarkerGlobalTranslation(MarkerIndex);
+      if (OutputTranslation.Result != ViconDataStreamSDK::CPP::Result::Success) {
+        continue;
+      }
+      auto slot = slots_.find(OutputTranslation.MarkerID);
+      if (slot == slots_.end()) {
+        markers.resize(first);
+        resolve(client, markers);
+        return false;
+      }
+      mocap_msgs::msg::Marker & marker = markers[first + slot->second];
+      marker.translation.x = OutputTranslation.Translation[0];
+      marker.translation.y = OutputTranslation.Translation[1];
+      marker.translation.z = OutputTranslation.Translation[2];
+      marker.occluded = false;
+    }
+    return true;
+  }
+
+  // Returns false if the subjects or their marker counts changed since the last frame
+  template<typename ClientT>
+  bool update_topology(const ClientT & client)
+  {
+    unsigned int SubjectCount = client.GetSubjectCount().SubjectCount;
+    bool same = SubjectCount == subject_names_.size();
+    subject_names_.resize(SubjectCount);
+    marker_counts_.resize(SubjectCount);
+    for (unsigned int SubjectIndex = 0; SubjectIndex < SubjectCount; ++SubjectIndex) {
+      std::string subject_name = client.GetSubjectName(SubjectIndex).SubjectName;
+      unsigned int MarkerCount = client.GetMarkerCount(subject_name).MarkerCount;
+      if (subject_name != subject_names_[SubjectIndex] ||
+        MarkerCount != marker_counts_[SubjectIndex])
+      {
+        same = false;
+        subject_names_[SubjectIndex] = subject_name;
+        marker_counts_[SubjectIndex] = MarkerCount;
+      }
+    }
+    if (!same) {
+      valid_ = false;
+      by_name_only_ = false;
+      slots_.clear();
+    }
+    return same;
+  }
+
+  // Reads the frame by name and binds the ids of the visible labeled markers to the subject
+  // markers at the same position
+  template<typename ClientT>
+  void resolve(const ClientT & client, std::vector<mocap_msgs::msg::Marker> & markers)
+  {
+    size_t first = markers.size();
+    read_by_name(client, markers);
+    resolutions_++;
+
+    positions_.clear();
+    occluded_markers_.assign(markers.begin() + first, markers.end());
+    for (size_t i = 0; i < occluded_markers_.size(); i++) {
+      mocap_msgs::msg::Marker & marker = occluded_markers_[i];
+      if (!marker.occluded) {
+        positions_.emplace_back(
+          std::array<double, 3>{marker.translation.x, marker.translation.y, marker.translation.z},
+          i);
+      }
+      marker.translation.x = 0.0;
+      marker.translation.y = 0.0;
+      marker.translation.z = 0.0;
+      marker.occluded = true;
+    }
+
+    std::sort(positions_.begin(), positions_.end());
+
+    size_t bound = 0;
+    unsigned int LabeledMarkerCount = client.GetLabeledMarkerCount().MarkerCount;
+    for (unsigned int MarkerIndex = 0; MarkerIndex < LabeledMarkerCount; ++MarkerIndex) {
+      ViconDataStreamSDK::CPP::Output_GetLabeledMarkerGlobalTranslation OutputTranslation =
+        client.GetLabeledMarkerGlobalTranslation(MarkerIndex);
+      if (OutputTranslation.Result != ViconDataStreamSDK::CPP::Result::Success) {
+        continue;
+      }
+      // The nearest marker within the tolerance, among those sorted by x around it
+      const double * translation = OutputTranslation.Translation;
+      auto position = std::lower_bound(
+        positions_.begin(), positions_.end(),
+        std::make_pair(
+          std::array<double, 3>{translation[0] - kBindTolerance, -HUGE_VAL, -HUGE_VAL},
+          static_cast<size_t>(0)));
+      size_t nearest = SIZE_MAX;
+      double nearest_distance = HUGE_VAL;
+      for (; position != positions_.end() &&
+        position->first[0] <= translation[0] + kBindTolerance; ++position)
+      {
+        double distance = 0.0;
+        for (int i = 0; i < 3; i++) {
+          distance = std::max(distance, std::fabs(position->first[i] - translation[i]));
+        }
+        if (distance <= kBindTolerance && distance < nearest_distance) {
+          nearest = position->second;
+          nearest_distance = distance;
+        }
+      }
+      if (nearest != SIZE_MAX) {
+        slots_[OutputTranslation.MarkerID] = nearest;
+        bound++;
+      }
+    }
+    unbound_ = positions_.size() > bound ? positions_.size() - bound : 0;
+    by_name_only_ = unbound_ > 0;
+    valid_ = true;
+    stale_ = false;
+  }
+
+  bool valid_;
+  // An id without slot was seen
+  bool stale_;
+  // Markers could not be bound, read by name until the topology changes
+  bool by_name_only_;
+  uint64_t resolutions_;
+  size_t unbound_;
+  std::vector<std::string> subject_names_;
+  std::vector<unsigned int> marker_counts_;
+  // Labeled markers with their names, all occluded: the start of every frame read by index
+  std::vector<mocap_msgs::msg::Marker> occluded_markers_;
+  // Labeled marker id -> position in occluded_markers_
+  std::unordered_map<unsigned int, size_t> slots_;
+  // Position of the visible markers read by name and their index, sorted, for resolve()
+  std::vector<std::pair<std::array<double, 3>, size_t>> positions_;
+};
+
+#endif  // VICON2_DRIVER__LABELED_MARKER_INDEX_HPP_
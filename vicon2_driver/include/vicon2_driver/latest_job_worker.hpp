@@ -0,0 +1,123 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__LATEST_JOB_WORKER_HPP_
+#define VICON2_DRIVER__LATEST_JOB_WORKER_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <boost/thread.hpp>
+
+// Processes jobs in its own thread, keeping only the latest one: a job posted while the
+// previous one is still waiting replaces it. Heavy outputs (blobs, video) are built here, so
+// the capture thread never waits for them and a slow consumer drops frames instead of
+// queuing them.
+template<typename Job>
+class LatestJobWorker
+{
+public:
+  explicit LatestJobWorker(std::function<void(Job &)> process)
+  : process_(process),
+    running_(false),
+    processed_(0),
+    dropped_(0)
+  {}
+
+  ~LatestJobWorker()
+  {
+    stop();
+  }
+
+  void start()
+  {
+    if (thread_.joinable()) {
+      return;
+    }
+    running_ = true;
+    thread_ = boost::thread(&LatestJobWorker::run, this);
+  }
+
+  // Waits for the job being processed, the pending one is discarded
+  void stop()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      running_ = false;
+      pending_.reset();
+    }
+    cond_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Returns false if the job replaced a pending one
+  bool post(std::unique_ptr<Job> job)
+  {
+    bool replaced;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      replaced = static_cast<bool>(pending_);
+      if (replaced) {
+        dropped_++;
+      }
+      pending_ = std::move(job);
+    }
+    cond_.notify_one();
+    return !replaced;
+  }
+
+  uint64_t processed() const
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return processed_;
+  }
+
+  uint64_t dropped() const
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return dropped_;
+  }
+
+private:
+  void run()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (running_) {
+      if (!pending_) {
+        cond_.wait(lock);
+        continue;
+      }
+      std::unique_ptr<Job> job = std::move(pending_);
+      lock.unlock();
+      process_(*job);
+      lock.lock();
+      processed_++;
+    }
+  }
+
+  std::function<void(Job &)> process_;
+  boost::thread thread_;
+  mutable boost::mutex mutex_;
+  boost::condition_variable cond_;
+  bool running_;
+  std::unique_ptr<Job> pending_;
+  uint64_t processed_;
+  uint64_t dropped_;
+};
+
+#endif  // VICON2_DRIVER__LATEST_JOB_WORKER_HPP_
@@ -0,0 +1,35 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__MARKER_CLOUD_HPP_
+#define VICON2_DRIVER__MARKER_CLOUD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sensor_msgs/msg/point_cloud2.hpp"
+
+// Markers as a point cloud, one point of 20 bytes per marker: x, y, z (float32, m), label
+// (int32, the position of a labeled marker in the markers message, -1 if unlabeled) and
+// occluded (uint8). Occluded markers have NaN coordinates.
+
+// Sets the fields and sizes the data of cloud for n_points markers
+void init_marker_cloud(sensor_msgs::msg::PointCloud2 & cloud, size_t n_points);
+
+// Writes a marker in the point index, translation in mm as given by the SDK
+void set_marker_point(
+  sensor_msgs::msg::PointCloud2 & cloud, size_t index, const double translation[3],
+  int32_t label, bool occluded);
+
+#endif  // VICON2_DRIVER__MARKER_CLOUD_HPP_
@@ -0,0 +1,124 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__MARKER_CLUSTER_HPP_
+#define VICON2_DRIVER__MARKER_CLUSTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Least squares rigid transform between n >= 3 points (n x 3 arrays), with Horn's closed form:
+// the rotation is the eigenvector of the largest eigenvalue of the 4 x 4 symmetric matrix built
+// from the cross covariance of the centered points, found with Jacobi rotations on the stack.
+// Gives position and orientation (x, y, z, w) such that observed = R model + position, and the
+// RMS distance left between them. Returns false for collinear points, whose rotation about
+// their line is not defined.
+bool solve_rigid_transform(
+  const double * model, const double * observed, size_t n, double position[3],
+  double orientation[4], double & residual);
+
+// A cluster of markers that is not a Vicon subject, defined by the positions of its markers in
+// its body frame and solved every frame from the streamed markers. The fit buffers are fixed
+// size arrays, so solving allocates nothing once warm.
+// A labeled cluster takes the labeled markers by name. An unlabeled one takes the unlabeled
+// markers of the frame: those of the last solution by track id (MarkerTracker), the missing
+// ones near the position the solution predicts for them, and when lost it is found again by
+// the distances between its markers, once all of them are seen. That search only looks at the
+// markers within the size of the cluster along x, so it takes O(n log n) for n scattered markers.
+class MarkerCluster
+{
+public:
+  static const size_t kMaxMarkers = 16;
+
+  MarkerCluster();
+
+  // marker_names: "subject/marker" of the labeled markers, empty for an unlabeled cluster.
+  // positions: 3 per marker in the body frame, in the unit of the markers. They may be left
+  // empty for a labeled cluster: the markers of the first frame they are all seen are taken,
+  // centered, with the axes of the world. Solutions with a larger RMS residual than
+  // max_residual are rejected. Returns false with error if the definition is not usable.
+  bool configure(
+    const std::string & name, const std::vector<std::string> & marker_names,
+    const std::vector<double> & positions, double max_residual, std::string & error);
+
+  // Forgets the markers bound to the cluster, not its model
+  void reset();
+
+  // Solves from the labeled markers of the cluster (3 per marker, in the order of
+  // marker_names) and whether each was seen
+  bool solve_labeled(const double * positions, const bool * seen);
+
+  // Solves from the n unlabeled markers of the frame (3 per marker) and their track ids, null
+  // if they are not tracked
+  bool solve_unlabeled(const double * positions, const uint32_t * ids, size_t n);
+
+  const std::string & name() const {return name_;}
+  bool labeled() const {return !marker_names_.empty();}
+  const std::vector<std::string> & marker_names() const {return marker_names_;}
+  size_t size() const {return n_markers_;}
+
+  // Last solution
+  bool solved() const {return solved_;}
+  const double * position() const {return position_;}
+  const double * orientation() const {return orientation_;}
+  double residual() const {return residual_;}
+  // Markers it was solved from
+  size_t used() const {return used_;}
+
+private:
+  static const size_t kNone = SIZE_MAX;
+  // Solutions tried while searching a lost unlabeled cluster, which bounds the search
+  static const unsigned int kMaxAcquireSolutions = 32;
+
+  // Solves from the observed position of the model markers with a marker in index
+  bool fit(const double * positions, const size_t * index);
+  // Searches the markers of the model from the distances between them
+  bool acquire(const double * positions, size_t n, size_t * index);
+  // Candidates of the model marker k among by_x_[begin, end), given the markers of the previous
+  bool search(const double * positions, size_t begin, size_t end, size_t k, size_t * index);
+  void set_model(const double * positions);
+
+  std::string name_;
+  std::vector<std::string> marker_names_;
+  size_t n_markers_;
+  double max_residual_;
+  // Largest error of a distance between two markers, or of a marker from its prediction
+  double tolerance_;
+  bool has_model_;
+  double model_[kMaxMarkers * 3];
+  double model_distance_[kMaxMarkers][kMaxMarkers];
+
+  // Track id of the unlabeled marker of every model marker, valid if bound_
+  uint32_t bound_id_[kMaxMarkers];
+  bool bound_[kMaxMarkers];
+  unsigned int acquire_solutions_;
+  // Largest distance of a marker from the first one, plus tolerance_
+  double extent_;
+  // x and index of the markers of the frame, sorted, for acquire()
+  std::vector<std::pair<double, size_t>> by_x_;
+
+  bool solved_;
+  double position_[3];
+  double orientation_[4];
+  double residual_;
+  size_t used_;
+  // Fit buffers
+  double fit_model_[kMaxMarkers * 3];
+  double fit_observed_[kMaxMarkers * 3];
+};
+
+#endif  // VICON2_DRIVER__MARKER_CLUSTER_HPP_
@@ -0,0 +1,99 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__MARKER_TRACKER_HPP_
+#define VICON2_DRIVER__MARKER_TRACKER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Gives the unlabeled markers ids that persist across frames. Each track is predicted to the
+// frame at its last velocity, and every marker is gated against the tracks in the 8 cells its
+// gate overlaps, in a grid of twice the gate: the tracks sorted by cell, with an open addressing
+// table from cell to its range, so there is no allocation once warm. At most kMaxCandidates
+// tracks are kept per marker and the closest pairs are assigned first,
+// so a frame is O(n log n) in the number of markers whatever their layout. Markers without a
+// track start a new one, and tracks without a marker are kept for max_missed frames.
+class MarkerTracker
+{
+public:
+  static const size_t kMaxCandidates = 4;
+
+  MarkerTracker();
+
+  // gate: largest distance between a marker and the predicted position of its track, in the
+  // unit of the positions. Forgets all the tracks.
+  void configure(double gate, uint32_t max_missed);
+  void reset();
+
+  // Associates the n_markers positions (x, y, z) of the frame at time t (s) to the tracks, and
+  // gives the track id of every marker in ids
+  void update(double t, const double * positions, size_t n_markers, std::vector<uint32_t> & ids);
+
+  size_t track_count() const {return id_.size();}
+  // Tracks started since configured
+  uint64_t started() const {return started_;}
+
+private:
+  class Candidate
+  {
+public:
+    double distance2;
+    uint32_t marker;
+    uint32_t track;
+    bool operator<(const Candidate & other) const {return distance2 < other.distance2;}
+  };
+
+  class Cell
+  {
+public:
+    uint64_t key;
+    uint32_t begin;
+    // 0 for an empty slot
+    uint32_t end;
+  };
+
+  uint64_t cell_key(int64_t ix, int64_t iy, int64_t iz) const;
+  int64_t cell(double value) const;
+  size_t cell_slot(uint64_t key) const;
+  void build_cells();
+  void start_track(double t, const double position[3]);
+
+  double gate_;
+  // 1 / cell size
+  double cell_scale_;
+  uint32_t max_missed_;
+  uint32_t next_id_;
+  uint64_t started_;
+
+  // Per track
+  std::vector<uint32_t> id_;
+  std::vector<uint32_t> missed_;
+  std::vector<double> last_time_;
+  // 3 per track
+  std::vector<double> position_;
+  std::vector<double> velocity_;
+  std::vector<double> predicted_;
+
+  // Per frame buffers
+  std::vector<std::pair<uint64_t, uint32_t>> grid_;
+  // Power of two sized
+  std::vector<Cell> cells_;
+  std::vector<Candidate> candidates_;
+  std::vector<uint8_t> track_matched_;
+};
+
+#endif  // VICON2_DRIVER__MARKER_TRACKER_HPP_
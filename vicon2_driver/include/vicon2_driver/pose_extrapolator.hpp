@@ -0,0 +1,47 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__POSE_EXTRAPOLATOR_HPP_
+#define VICON2_DRIVER__POSE_EXTRAPOLATOR_HPP_
+
+// Short-horizon prediction of the pose of an occluded segment, at the constant linear and
+// angular velocities of the last two poses seen. Orientations are quaternions (x, y, z, w).
+class PoseExtrapolator
+{
+public:
+  PoseExtrapolator();
+
+  void reset();
+
+  // Pose seen at time t (s), position in m
+  void update(double t, const double position[3], const double orientation[4]);
+
+  // Pose at time t. Returns false before two poses were seen, or when t is more than max_gap
+  // (s) after the last one.
+  bool predict(double t, double max_gap, double position[3], double orientation[4]) const;
+
+  bool has_pose() const {return n_poses_ > 0;}
+  double last_time() const {return last_time_;}
+
+private:
+  int n_poses_;
+  double last_time_;
+  double position_[3];
+  double orientation_[4];
+  double velocity_[3];
+  // Rotation vector rate in the world frame, rad/s
+  double angular_velocity_[3];
+};
+
+#endif  // VICON2_DRIVER__POSE_EXTRAPOLATOR_HPP_
@@ -0,0 +1,71 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__POSE_JUMP_FILTER_HPP_
+#define VICON2_DRIVER__POSE_JUMP_FILTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Checks the poses of many bodies before they are published. The sign of every quaternion is
+// kept in the hemisphere of the last accepted one, and poses that moved or turned faster than
+// the given limits since it (e.g. a flip from mislabeled markers) are rejected. After
+// max_rejected consecutive rejections the body is taken to have really moved and the pose is
+// accepted. The last accepted pose of all the bodies is kept in one array per component.
+class PoseJumpFilter
+{
+public:
+  enum Result
+  {
+    ACCEPTED,
+    // Accepted with the sign of the quaternion changed
+    FLIPPED,
+    REJECTED
+  };
+
+  PoseJumpFilter();
+
+  // Limits in m/s and rad/s, forgets all the bodies
+  void configure(double max_linear_velocity, double max_angular_velocity, uint32_t max_rejected);
+
+  // Adds a body and returns its index
+  size_t add_body();
+  void clear();
+  size_t size() const {return last_time_.size();}
+
+  // Pose of a body seen at time t (s), position in m and orientation (x, y, z, w), which is
+  // negated when FLIPPED
+  Result filter(size_t body, double t, const double position[3], double orientation[4]);
+
+  uint64_t flipped() const {return flipped_;}
+  uint64_t rejected() const {return rejected_;}
+
+private:
+  double max_linear_velocity_;
+  double max_angular_velocity_;
+  uint32_t max_rejected_;
+  uint64_t flipped_;
+  uint64_t rejected_;
+
+  std::vector<double> last_time_;
+  std::vector<uint8_t> valid_;
+  std::vector<uint32_t> rejected_run_;
+  // 3 per body
+  std::vector<double> last_position_;
+  // 4 per body
+  std::vector<double> last_orientation_;
+};
+
+#endif  // VICON2_DRIVER__POSE_JUMP_FILTER_HPP_
@@ -0,0 +1,77 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__POSE_PREDICTION_HPP_
+#define VICON2_DRIVER__POSE_PREDICTION_HPP_
+
+#include <cstddef>
+#include <deque>
+
+// Pose after horizon (s) at the constant twist linear (m/s) and angular (rad/s), both in the
+// world frame. The orientation (x, y, z, w) is integrated exactly: it is rotated by
+// exp(angular * horizon) in the world frame.
+void predict_pose(
+  const double position[3], const double orientation[4], const double linear[3],
+  const double angular[3], double horizon, double predicted_position[3],
+  double predicted_orientation[4]);
+
+// Errors of a prediction against the pose observed at its time, and of the pose it was
+// predicted from (what is published without prediction)
+class PredictionError
+{
+public:
+  double position;
+  double orientation;
+  double last_position;
+  double last_orientation;
+  PredictionError()
+  : position(0.0), orientation(0.0), last_position(0.0), last_orientation(0.0) {}
+};
+
+// Keeps the pending predictions of a body until a frame at their time is observed
+class PredictionEvaluator
+{
+public:
+  explicit PredictionEvaluator(size_t max_pending = 64);
+
+  // Prediction for time t (s) made from the last pose of the body
+  void add(
+    double t, const double position[3], const double orientation[4],
+    const double last_position[3], const double last_orientation[4]);
+
+  // Compares the pose observed at time t with the prediction for t, if any within tolerance
+  // (s). Older predictions are discarded. Returns false if there was none.
+  bool observe(
+    double t, double tolerance, const double position[3], const double orientation[4],
+    PredictionError & error);
+
+  void clear() {pending_.clear();}
+  size_t pending() const {return pending_.size();}
+
+private:
+  class Prediction
+  {
+public:
+    double t;
+    double position[3];
+    double orientation[4];
+    double last_position[3];
+    double last_orientation[4];
+  };
+
+  size_t max_pending_;
+  std::deque<Prediction> pending_;
+};
+
+#endif  // VICON2_DRIVER__POSE_PREDICTION_HPP_
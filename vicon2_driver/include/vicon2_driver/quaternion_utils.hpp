@@ -0,0 +1,97 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__QUATERNION_UTILS_HPP_
+#define VICON2_DRIVER__QUATERNION_UTILS_HPP_
+
+#include <cmath>
+
+// Quaternion helpers on plain arrays (x, y, z, w), for the per-body estimators that work
+// outside tf2.
+
+// r = a * b, r may be a or b
+inline void quaternion_multiply(const double a[4], const double b[4], double r[4])
+{
+  double x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+  double y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+  double z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+  double w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+  r[0] = x;
+  r[1] = y;
+  r[2] = z;
+  r[3] = w;
+}
+
+inline void quaternion_conjugate(const double q[4], double r[4])
+{
+  r[0] = -q[0];
+  r[1] = -q[1];
+  r[2] = -q[2];
+  r[3] = q[3];
+}
+
+inline void quaternion_normalize(double q[4])
+{
+  double norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int i = 0; i < 4; i++) {
+    q[i] /= norm;
+  }
+}
+
+// Rotation vector (axis * angle, rad) of q, taking the shortest of q and -q
+inline void quaternion_to_rotation_vector(const double q[4], double v[3])
+{
+  double sign = q[3] < 0.0 ? -1.0 : 1.0;
+  double sin_half = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+  if (sin_half < 1e-12) {
+    // First order, the axis is not defined
+    for (int i = 0; i < 3; i++) {
+      v[i] = 2.0 * sign * q[i];
+    }
+    return;
+  }
+  double angle = 2.0 * std::atan2(sin_half, sign * q[3]);
+  for (int i = 0; i < 3; i++) {
+    v[i] = sign * q[i] / sin_half * angle;
+  }
+}
+
+inline void rotation_vector_to_quaternion(const double v[3], double q[4])
+{
+  double angle = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (angle < 1e-12) {
+    q[0] = v[0] / 2.0;
+    q[1] = v[1] / 2.0;
+    q[2] = v[2] / 2.0;
+    q[3] = 1.0;
+    quaternion_normalize(q);
+    return;
+  }
+  double scale = std::sin(angle / 2.0) / angle;
+  q[0] = v[0] * scale;
+  q[1] = v[1] * scale;
+  q[2] = v[2] * scale;
+  q[3] = std::cos(angle / 2.0);
+}
+
+// Rotation vector of the rotation from q0 to q1 in the world frame (q1 * q0^-1)
+inline void quaternion_delta(const double q0[4], const double q1[4], double v[3])
+{
+  double inverse[4], delta[4];
+  quaternion_conjugate(q0, inverse);
+  quaternion_multiply(q1, inverse, delta);
+  quaternion_to_rotation_vector(delta, v);
+}
+
+#endif  // VICON2_DRIVER__QUATERNION_UTILS_HPP_
@@ -0,0 +1,62 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__REALTIME_UTILS_HPP_
+#define VICON2_DRIVER__REALTIME_UTILS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Helpers to run the capture thread with real-time settings. All of them return false
+// and fill error when the operating system refuses the request (e.g. missing rtprio limits).
+
+// Set SCHED_FIFO with the given priority (1-99) for the calling thread.
+bool set_thread_realtime_priority(int priority, std::string & error);
+
+// Pin the calling thread to the given CPU ids. Ids out of the range of the system are refused.
+bool set_thread_cpu_affinity(const std::vector<int64_t> & cpus, std::string & error);
+
+// CPU ids as "0,2,3", for the logs and diagnostics.
+std::string cpu_list_to_string(const std::vector<int64_t> & cpus);
+
+// Lock current and future pages of the process in RAM.
+bool lock_process_memory(std::string & error);
+
+// Touch the stack of the calling thread.
+void prefault_stack();
+
+// Statistics of the difference between the measured and the expected wake-up period
+class JitterStats
+{
+public:
+  JitterStats();
+
+  void add(double jitter);
+  void reset();
+
+  unsigned int count() const {return count_;}
+  double mean() const;
+  double stddev() const;
+  double max_abs() const {return max_abs_;}
+
+private:
+  unsigned int count_;
+  double sum_;
+  double sum_sq_;
+  double max_abs_;
+};
+
+#endif  // VICON2_DRIVER__REALTIME_UTILS_HPP_
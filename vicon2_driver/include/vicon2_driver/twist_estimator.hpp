@@ -0,0 +1,107 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__TWIST_ESTIMATOR_HPP_
+#define VICON2_DRIVER__TWIST_ESTIMATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linear and angular velocity of many bodies from their poses, with a constant acceleration
+// Kalman filter or a Savitzky-Golay fit (local quadratic least squares, which also copes with
+// dropped frames) per channel. Every body has 6 channels: its position and its accumulated
+// world frame rotation vector, whose derivative is the angular velocity. The state of all the
+// bodies is kept in one array per component, indexed by body * 6 + channel, and all of them
+// are updated in a single pass per frame.
+class TwistEstimator
+{
+public:
+  enum Method
+  {
+    KALMAN,
+    SAVITZKY_GOLAY
+  };
+
+  static const size_t kChannels = 6;
+
+  TwistEstimator();
+
+  // Sets the filter and forgets all the bodies.
+  // window: samples of the Savitzky-Golay fit (3 or more).
+  // process_noise: spectral density of the jerk for the Kalman filter.
+  // measurement_noise: variance of the positions (m^2) and rotations (rad^2) measured.
+  // Bodies not seen for more than max_gap (s) start again.
+  void configure(
+    Method method, size_t window, double process_noise, double measurement_noise,
+    double max_gap);
+
+  // "kalman" or "savitzky_golay"
+  static bool parse_method(const std::string & name, Method & method);
+
+  // Adds a body and returns its index
+  size_t add_body();
+  void clear();
+  size_t size() const {return last_time_.size();}
+
+  // Pose of a body seen in the current frame (position in m, orientation x, y, z, w), used by
+  // the next update()
+  void set_pose(size_t body, const double position[3], const double orientation[4]);
+
+  // Runs the filter of the bodies with a pose set since the last update, at time t (s)
+  void update(double t);
+
+  // Twist of a body in the world frame (m/s, rad/s) and the variances of its 6 components.
+  // Returns false until the body was seen twice.
+  bool twist(size_t body, double linear[3], double angular[3], double variance[6]) const;
+
+private:
+  void update_kalman(size_t body, double dt);
+  void update_savitzky_golay(size_t body, double t);
+
+  Method method_;
+  size_t window_;
+  double process_noise_;
+  double measurement_noise_;
+  double max_gap_;
+
+  // Per body
+  std::vector<double> last_time_;
+  std::vector<uint32_t> samples_;
+  std::vector<uint8_t> seen_;
+  // Last orientation (4 per body), to accumulate the rotation vector
+  std::vector<double> orientation_;
+  // Per body and channel
+  std::vector<double> measurement_;
+  std::vector<double> rotation_;
+  std::vector<double> velocity_;
+  std::vector<double> velocity_variance_;
+  // Kalman state: position, velocity and acceleration and the upper triangle of their
+  // covariance
+  std::vector<double> x_;
+  std::vector<double> v_;
+  std::vector<double> a_;
+  std::vector<double> p00_;
+  std::vector<double> p01_;
+  std::vector<double> p02_;
+  std::vector<double> p11_;
+  std::vector<double> p12_;
+  std::vector<double> p22_;
+  // Savitzky-Golay ring buffers: window_ times per body, window_ samples per body and channel
+  std::vector<double> history_time_;
+  std::vector<double> history_;
+};
+
+#endif  // VICON2_DRIVER__TWIST_ESTIMATOR_HPP_
@@ -17,6 +17,7 @@
 #ifndef VICON2_DRIVER__VICON2_DRIVER_HPP_
 #define VICON2_DRIVER__VICON2_DRIVER_HPP_
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include <map>
@@ -31,6 +32,15 @@
 
 #include "mocap_msgs/msg/marker.hpp"
 #include "mocap_msgs/msg/markers.hpp"
+#include "vicon2_msgs/msg/camera_calibrations.hpp"
+#include "vicon2_msgs/msg/centroids.hpp"
+#include "vicon2_msgs/msg/device_frame.hpp"
+#include "vicon2_msgs/msg/device_schema.hpp"
+#include "vicon2_msgs/msg/force_plate.hpp"
+#include "vicon2_msgs/msg/frame_metadata.hpp"
+#include "vicon2_msgs/msg/greyscale_blobs.hpp"
+#include "vicon2_msgs/msg/marker_rays.hpp"
+#include "vicon2_msgs/msg/segment_batch.hpp"
 #include "std_msgs/msg/empty.hpp"
 
 #include "rclcpp/rclcpp.hpp"
@@ -42,6 +52,7 @@
 #include "lifecycle_msgs/srv/get_state.hpp"
 #include "geometry_msgs/msg/transform_stamped.hpp"
 #include "nav_msgs/msg/odometry.hpp"
+#include "diagnostic_updater/diagnostic_updater.hpp"
 
 #include "tf2/transform_datatypes.h"
 #include "tf2/buffer_core.h"
@@ -51,6 +62,21 @@
 
 #include "device_control/ControlledLifecycleNode.hpp"
 
+#include "vicon2_driver/realtime_utils.hpp"
+#include "vicon2_driver/frame_clock_estimator.hpp"
+#include "vicon2_driver/frame_gap_tracker.hpp"
+#include "vicon2_driver/labeled_marker_index.hpp"
+#include "vicon2_driver/latest_job_worker.hpp"
+#include "vicon2_driver/marker_cloud.hpp"
+#include "vicon2_driver/marker_cluster.hpp"
+#include "vicon2_driver/marker_tracker.hpp"
+#include "vicon2_driver/pose_extrapolator.hpp"
+#include "vicon2_driver/pose_jump_filter.hpp"
+#include "vicon2_driver/pose_prediction.hpp"
+#include "vicon2_driver/twist_estimator.hpp"
+#include "vicon2_driver/worker_pool.hpp"
+#include "vicon2_driver/video_utils.hpp"
+
 class SegmentPublisher
 {
 public:
@@ -66,16 +92,122 @@ public:
 
 typedef std::map<std::string, SegmentPublisher> SegmentMap;
 
+class SegmentTrack;
+
+// A segment of the current frame, read from the client in the capture thread and published by
+// a subject worker
+class SegmentSample
+{
+public:
+  std::string subject_name;
+  std::string segment_name;
+  bool occluded;
+  // The segment was not seen and transform was extrapolated, with the odometry variance scaled
+  // by variance_scale
+  bool predicted;
+  double variance_scale;
+  // Twist of the segment in the world frame and the variances of its 6 components
+  size_t twist_body;
+  bool has_twist;
+  double linear_velocity[3];
+  double angular_velocity[3];
+  double twist_variance[6];
+  // Filled when published, the pose predicted prediction_horizon_ ahead
+  bool has_prediction;
+  tf2::Transform predicted_transform;
+  SegmentTrack * track;
+  // Object quality of the subject (-1 if not reported) and whether it is below the minimum
+  double quality;
+  bool low_quality;
+  // RMS residual (m) of a marker cluster solution, -1 for Vicon subjects
+  double residual;
+  // A jump rejected by the pose filter
+  bool rejected;
+  tf2::Transform transform;
+  // Null while the publishers of the segment are being created
+  SegmentPublisher * publisher;
+  // Filled when published, for the TF broadcast
+  bool has_tf;
+  geometry_msgs::msg::TransformStamped tf_msg;
+  SegmentSample()
+  : occluded(true), predicted(false), variance_scale(1.0), twist_body(0), has_twist(false),
+    has_prediction(false), track(nullptr), quality(-1.0), low_quality(false), residual(-1.0),
+    rejected(false), publisher(nullptr), has_tf(false) {}
+
+  // The pose of this frame is valid
+  bool seen() const {return !occluded && !low_quality && !rejected;}
+};
+
+// Occlusion state of a segment, kept by the capture thread
+class SegmentTrack
+{
+public:
+  PoseExtrapolator extrapolator;
+  // Body of the segment in the twist estimator
+  size_t twist_body;
+  // Body of the segment in the pose jump filter
+  size_t jump_filter_body;
+  PredictionEvaluator evaluator;
+  bool occluded;
+  // Time of the last pose seen before the occlusion (s) and whether every frame since was
+  // predicted
+  double occluded_since;
+  bool bridged;
+  SegmentTrack()
+  : twist_body(0), jump_filter_body(0), occluded(false), occluded_since(0.0), bridged(true) {}
+};
+
+typedef std::map<std::string, SegmentTrack> SegmentTrackMap;
+
+// A Vicon DataStream server and the frame continuity of the driver while connected to it
+class ViconServer
+{
+public:
+  std::string host_name;
+  FrameGapTracker frame_gaps;
+  // Frame rate the drop rate windows of frame_gaps were sized for
+  double window_rate;
+  ViconServer() : window_rate(0.0) {}
+};
+
+// A device output component, resolved once so the frames only carry its values
+class DeviceChannel
+{
+public:
+  std::string device_name;
+  std::string output_name;
+  std::string component_name;
+};
+
+// Greyscale blobs read from the client in the capture thread, packed into a message by the
+// blob worker
+class GreyscaleBlobsJob
+{
+public:
+  rclcpp::Time frame_time;
+  unsigned int frame_number;
+  std::vector<unsigned int> camera_ids;
+  std::vector<ViconDataStreamSDK::CPP::Output_GetGreyscaleBlobSubsampleInfo> subsample_info;
+  std::vector<std::vector<ViconDataStreamSDK::CPP::Output_GetGreyscaleBlob>> blobs;
+};
+
+// Video frames of a Vicon frame. The pixels stay in the buffers shared with the client until
+// the video worker copies them into the images. The publishers go with the frames, so the
+// worker never looks them up while the capture thread creates them.
+class VideoJob
+{
+public:
+  rclcpp::Time frame_time;
+  std::vector<std::string> camera_names;
+  std::vector<ViconDataStreamSDK::CPP::Output_GetVideoFrame> frames;
+  std::vector<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::Image>::SharedPtr> pubs;
+};
+
 class ViconDriverNode : public device_control::ControlledLifecycleNode
 {
 public:
-  explicit ViconDriverNode(
-    const rclcpp::NodeOptions options =
-    rclcpp::NodeOptions().parameter_overrides(
-      std::vector<rclcpp::Parameter> {
-    rclcpp::Parameter("use_sim_time", true)
-  }));
-  ~ViconDriverNode()  override {}
+  explicit ViconDriverNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+  ~ViconDriverNode() override;
   using CallbackReturnT =
     rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
 
@@ -87,7 +219,7 @@ public:
   CallbackReturnT on_error(const rclcpp_lifecycle::State & state);
   bool connect_vicon();
   void set_settings_vicon();
-  void start_vicon();
+  bool start_vicon();
   bool stop_vicon();
   void initParameters();
 
@@ -98,13 +230,50 @@ protected:
   rclcpp::Time now_time;
   std::string myParam;
   rclcpp_lifecycle::LifecyclePublisher<mocap_msgs::msg::Markers>::SharedPtr marker_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::MarkerRays>::SharedPtr marker_rays_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::PointCloud2>::SharedPtr
+    marker_cloud_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::FrameMetadata>::SharedPtr metadata_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::ForcePlate>::SharedPtr force_plate_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::DeviceSchema>::SharedPtr
+    device_schema_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::DeviceFrame>::SharedPtr device_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::SegmentBatch>::SharedPtr
+    segment_batch_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::SegmentBatch>::SharedPtr
+    predicted_batch_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::CameraCalibrations>::SharedPtr
+    camera_calibration_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::Centroids>::SharedPtr centroids_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<vicon2_msgs::msg::GreyscaleBlobs>::SharedPtr
+    greyscale_blobs_pub_;
   std::shared_ptr<tf2_ros::TransformBroadcaster> tf_broadcaster_;
   std::string stream_mode_;
   std::string host_name_;
+  std::vector<std::string> host_names_;
+  double failover_timeout_periods_;
   std::string tf_ref_frame_id_;
   std::string tracked_frame_suffix_;
   bool publish_markers_;
+  bool publish_marker_rays_;
+  bool labeled_markers_by_index_;
+  bool publish_marker_cloud_;
   bool publish_subjects_;
+  bool publish_frame_metadata_;
+  bool publish_force_plates_;
+  bool publish_devices_;
+  bool publish_segment_batch_;
+  bool publish_eye_trackers_;
+  std::vector<std::string> eye_tracker_segments_;
+  bool publish_camera_calibration_;
+  double camera_calibration_refresh_s_;
+  bool publish_centroids_;
+  std::vector<int64_t> centroid_camera_ids_;
+  bool publish_greyscale_blobs_;
+  std::vector<int64_t> greyscale_camera_ids_;
+  bool publish_video_;
+  std::vector<int64_t> video_camera_ids_;
+  int video_qos_depth_;
   bool broadcast_tf_;
   bool marker_data_enabled_;
   bool unlabeled_marker_data_enabled_;
@@ -113,15 +282,191 @@ protected:
   int droppedFrameCount_;
   int n_markers_;
   int n_unlabeled_markers_;
+  bool track_unlabeled_markers_;
+  double marker_track_gate_mm_;
+  int marker_track_max_missed_;
+  std::vector<std::string> marker_cluster_names_;
+  // Markers and positions of every cluster, read from marker_clusters.<name>.*
+  std::vector<std::vector<std::string>> marker_cluster_markers_;
+  std::vector<std::vector<double>> marker_cluster_positions_;
+  double max_cluster_residual_mm_;
   std::string qos_history_policy_;
   std::string qos_reliability_policy_;
   int qos_depth_;
   boost::mutex segments_mutex_;
   SegmentMap segment_publishers_;
+  int subject_worker_threads_;
+  double min_object_quality_;
+  double pose_variance_;
+  uint64_t low_quality_count_;
+  int max_extrapolation_ms_;
+  SegmentTrackMap segment_tracks_;
+  unsigned int occluded_segments_;
+  double longest_occlusion_;
+  uint64_t predicted_pose_count_;
+  uint64_t occlusion_count_;
+  uint64_t bridged_occlusion_count_;
+  JitterStats occlusion_durations_;
+  std::string twist_estimator_name_;
+  int twist_window_;
+  double twist_process_noise_;
+  bool twist_enabled_;
+  TwistEstimator twist_estimator_;
+  bool pose_filter_;
+  double max_linear_velocity_;
+  double max_angular_velocity_;
+  int max_rejected_frames_;
+  PoseJumpFilter pose_jump_filter_;
+  uint64_t flipped_pose_count_;
+  uint64_t rejected_pose_count_;
+  bool publish_predicted_poses_;
+  double prediction_offset_ms_;
+  bool evaluate_prediction_;
+  // Latency total + prediction offset of the current frame (s)
+  double prediction_horizon_;
+  uint64_t evaluated_prediction_count_;
+  JitterStats prediction_position_error_;
+  JitterStats prediction_orientation_error_;
+  JitterStats unpredicted_position_error_;
+  JitterStats unpredicted_orientation_error_;
+  WorkerPool subject_pool_;
+  std::vector<SegmentSample> segment_samples_;
+  int capture_thread_priority_;
+  std::vector<int64_t> capture_thread_cpus_;
+  bool lock_memory_;
+  int reserved_frame_items_;
+  int connection_timeout_ms_;
+  int reconnect_backoff_initial_ms_;
+  int reconnect_backoff_max_ms_;
+  std::string timestamp_mode_;
+  int clock_estimator_window_;
+  double clock_outlier_threshold_;
+  double clock_max_drift_ppm_;
+  std::vector<double> drop_rate_windows_;
+  double drop_budget_pct_;
+  int drop_alert_period_ms_;
+
+  // The frames are acquired in their own thread, so activation returns immediately and the
+  // thread can be given real-time scheduling without affecting the executor threads
+  boost::thread capture_thread_;
+  std::atomic<bool> capture_running_;
+  boost::mutex capture_stats_mutex_;
+  // Set by the capture thread and on activation, read by the diagnostics
+  std::atomic<bool> realtime_priority_set_;
+  std::atomic<bool> cpu_affinity_set_;
+  std::atomic<bool> memory_locked_;
+  std::chrono::steady_clock::time_point frame_wakeup_time_;
+  std::chrono::steady_clock::time_point last_wakeup_time_;
+  JitterStats wakeup_jitter_;
+  std::atomic<bool> connected_;
+  std::atomic<bool> reconnecting_;
+  std::chrono::steady_clock::time_point disconnection_time_;
+  unsigned int connection_attempts_;
+  unsigned int reconnect_count_;
+  double last_reconnect_time_;
+  double max_reconnect_time_;
+  std::vector<ViconServer> servers_;
+  size_t active_server_;
+  double frame_rate_;
+  std::chrono::steady_clock::time_point last_frame_time_;
+  bool failing_over_;
+  std::chrono::steady_clock::time_point failover_start_time_;
+  unsigned int failover_count_;
+  double last_failover_time_;
+  double max_failover_time_;
+  FrameClockEstimator clock_estimator_;
+  LabeledMarkerIndex labeled_marker_index_;
+  // Labeled markers read by name for the point cloud, when their ids are not all bound
+  std::vector<mocap_msgs::msg::Marker> cloud_markers_;
+  // Copied from labeled_marker_index_ for the diagnostics
+  uint64_t labeled_marker_resolutions_;
+  size_t unbound_labeled_markers_;
+  MarkerTracker marker_tracker_;
+  // Copied from marker_tracker_ for the diagnostics
+  uint64_t unlabeled_track_count_;
+  uint64_t unlabeled_tracks_started_;
+  std::vector<MarkerCluster> marker_clusters_;
+  // Position of the labeled markers of every cluster in the markers of the last frame
+  std::vector<std::vector<size_t>> cluster_marker_slots_;
+  // Solved in the last frame, and solutions rejected since configured
+  unsigned int solved_cluster_count_;
+  uint64_t unsolved_cluster_count_;
+  // x, y, z of the unlabeled markers of the frame, and their track ids
+  std::vector<double> unlabeled_positions_;
+  std::vector<uint32_t> unlabeled_ids_;
+  std::vector<DeviceChannel> device_channels_;
+  unsigned int device_count_;
+  uint32_t device_schema_id_;
+  bool device_schema_valid_;
+  size_t device_values_size_;
+  bool camera_calibration_valid_;
+  unsigned int camera_count_;
+  std::chrono::steady_clock::time_point camera_calibration_time_;
+  std::vector<vicon2_msgs::msg::CameraCalibration> camera_calibration_;
+  // Names and ids of the cameras, refreshed when their number changes
+  std::vector<std::string> camera_names_;
+  std::vector<unsigned int> camera_ids_;
+  std::vector<bool> camera_is_video_;
+  bool camera_list_valid_;
+  bool camera_filter_pending_;
+  size_t centroid_count_;
+  // Throttling of the capture warnings, independent of use_sim_time
+  rclcpp::Clock steady_clock_;
+  LatestJobWorker<GreyscaleBlobsJob> blob_worker_;
+  LatestJobWorker<VideoJob> video_worker_;
+  // Image publishers by camera id, created by the capture thread as video cameras show up
+  std::map<
+    unsigned int,
+    rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::Image>::SharedPtr> video_pubs_;
+  std::shared_ptr<diagnostic_updater::Updater> diag_updater_;
+
+  void capture_thread_main();
+  void configure_capture_thread();
+  bool configure_worker_thread();
+  void reserve_frame_buffers();
+  void stop_capture_thread();
+  void wait_capture(std::chrono::milliseconds time);
+  void select_server(size_t index);
+  void diagnose_connection(diagnostic_updater::DiagnosticStatusWrapper & stat);
+  void diagnose_capture(diagnostic_updater::DiagnosticStatusWrapper & stat);
+  FrameGapTracker::Result update_frame_gaps(uint32_t frame_number);
+  void diagnose_frame_drops(diagnostic_updater::DiagnosticStatusWrapper & stat);
 
   void process_frame();
-  void process_markers(const rclcpp::Time & frame_time, unsigned int vicon_frame_num);
-  void process_subjects(const rclcpp::Time & frame_time);
+  rclcpp::Time stamp_frame(
+    const rclcpp::Time & latency_stamp,
+    const ViconDataStreamSDK::CPP::Output_GetHardwareFrameNumber & OutputHardwareFrameNum,
+    bool & from_hardware_frame);
+  void fill_timecode(vicon2_msgs::msg::FrameMetadata & metadata_msg);
+  void diagnose_timestamping(diagnostic_updater::DiagnosticStatusWrapper & stat);
+  void process_markers(
+    const rclcpp::Time & frame_time, double frame_clock, unsigned int vicon_frame_num);
+  void process_marker_cloud(const rclcpp::Time & frame_time);
+  void check_labeled_marker_index();
+  void solve_marker_clusters(
+    const std::vector<mocap_msgs::msg::Marker> & markers, size_t first_unlabeled);
+  void process_subjects(
+    const rclcpp::Time & frame_time, double frame_clock,
+    vicon2_msgs::msg::SegmentBatch * batch_msg = nullptr);
+  void publish_segment(SegmentSample & sample, const rclcpp::Time & frame_time);
+  void diagnose_occlusions(diagnostic_updater::DiagnosticStatusWrapper & stat);
+  bool evaluate_prediction(
+    const SegmentSample & sample, double frame_clock, PredictionError & error);
+  void diagnose_prediction(diagnostic_updater::DiagnosticStatusWrapper & stat);
+  void process_eye_trackers(vicon2_msgs::msg::SegmentBatch & batch_msg);
+  void process_camera_calibration(const rclcpp::Time & frame_time);
+  void update_camera_list();
+  bool is_streamed_video_camera(size_t camera) const;
+  void set_camera_filter();
+  void process_centroids(const rclcpp::Time & frame_time, unsigned int vicon_frame_num);
+  void process_greyscale_blobs(const rclcpp::Time & frame_time, unsigned int vicon_frame_num);
+  void pack_greyscale_blobs(GreyscaleBlobsJob & job);
+  void process_video(const rclcpp::Time & frame_time);
+  void publish_video(VideoJob & job);
+  bool fill_video_image(const VideoJob & job, size_t i, sensor_msgs::msg::Image & image);
+  void process_force_plates(const rclcpp::Time & frame_time, unsigned int vicon_frame_num);
+  void process_devices(const rclcpp::Time & frame_time, unsigned int vicon_frame_num);
+  void resolve_device_schema(const rclcpp::Time & frame_time);
   void marker_to_tf(
     mocap_msgs::msg::Marker marker,
     int marker_num, const rclcpp::Time & frame_time);
@@ -0,0 +1,39 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__VICON2_POSE_CONSUMER_HPP_
+#define VICON2_DRIVER__VICON2_POSE_CONSUMER_HPP_
+
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+
+// Sample consumer meant to be composed in the same container as the driver.
+// It takes the odometry of one segment by unique_ptr, so with intra-process
+// communication enabled the message published by the driver is received without a copy.
+class ViconPoseConsumer : public rclcpp::Node
+{
+public:
+  explicit ViconPoseConsumer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+
+protected:
+  void odom_callback(nav_msgs::msg::Odometry::UniquePtr msg);
+
+  std::string odom_topic_;
+  unsigned int msg_count_;
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
+};
+
+#endif  // VICON2_DRIVER__VICON2_POSE_CONSUMER_HPP_
@@ -0,0 +1,35 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__VIDEO_UTILS_HPP_
+#define VICON2_DRIVER__VIDEO_UTILS_HPP_
+
+#include <string>
+
+#include "sensor_msgs/msg/image.hpp"
+
+#include "DataStreamClient.h"
+
+// sensor_msgs/Image encoding of a Vicon video format, empty if not supported
+std::string video_format_encoding(unsigned int format);
+
+// Bytes per pixel of a Vicon video format, 0 if not supported
+unsigned int video_format_pixel_size(unsigned int format);
+
+// Copies a video frame into image (size, encoding and pixels, the header is left untouched).
+// Returns false if the frame has no data or an unsupported format.
+bool fill_image(
+  const ViconDataStreamSDK::CPP::Output_GetVideoFrame & frame, sensor_msgs::msg::Image & image);
+
+#endif  // VICON2_DRIVER__VIDEO_UTILS_HPP_
@@ -0,0 +1,67 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VICON2_DRIVER__WORKER_POOL_HPP_
+#define VICON2_DRIVER__WORKER_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+// Fixed pool of threads running a function over the items of a frame. The items are handed
+// out one at a time from a shared counter, so a thread that finishes early takes over the
+// remaining ones instead of waiting for a fixed share, and run() returns when all of them are
+// done: a barrier per frame.
+class WorkerPool
+{
+public:
+  WorkerPool();
+  ~WorkerPool();
+
+  // With no threads run() calls the function in the calling thread. Every thread calls
+  // thread_init (if given) once when it starts, e.g. to take the scheduling of the caller.
+  void start(size_t n_threads, const std::function<bool()> & thread_init = nullptr);
+  void stop();
+  // Both can be read from any thread
+  size_t size() const {return n_threads_;}
+  // Threads whose thread_init returned true
+  size_t initialized() const {return initialized_threads_;}
+
+  // Calls process(i) for every i in [0, n_items), in the pool threads and in the calling one
+  void run(size_t n_items, const std::function<void(size_t)> & process);
+
+private:
+  // generation is the last run() before the thread was started
+  void thread_main(uint64_t generation, std::function<bool()> thread_init);
+  void work();
+
+  std::vector<boost::thread> threads_;
+  boost::mutex mutex_;
+  boost::condition_variable start_cond_;
+  boost::condition_variable done_cond_;
+  bool running_;
+  uint64_t generation_;
+  size_t busy_threads_;
+  const std::function<void(size_t)> * process_;
+  size_t n_items_;
+  std::atomic<size_t> next_item_;
+  std::atomic<size_t> n_threads_;
+  std::atomic<size_t> initialized_threads_;
+};
+
+#endif  // VICON2_DRIVER__WORKER_POOL_HPP_
@@ -0,0 +1,89 @@
+# Copyright 2019 Intelligent Robotics Lab
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+from ament_index_python.packages import get_package_share_directory
+
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.actions import ExecuteProcess
+from launch.actions import TimerAction
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
+
+
+def generate_launch_description():
+
+    params_file_path = os.path.join(get_package_share_directory(
+      'vicon2_driver'), 'config', 'vicon2_driver_params.yaml')
+
+    odom_topic = LaunchConfiguration('odom_topic')
+
+    declare_odom_topic_cmd = DeclareLaunchArgument(
+        'odom_topic',
+        default_value='vicon/robot/robot_odom',
+        description='Odometry topic of the segment the sample consumer listens to')
+
+    # Both nodes live in the same process, so with intra-process communication
+    # the poses published by the driver reach the consumer without serialization
+    container = ComposableNodeContainer(
+        name='vicon2_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container_mt',
+        composable_node_descriptions=[
+            ComposableNode(
+                package='vicon2_driver',
+                plugin='ViconDriverNode',
+                name='vicon2_driver_node',
+                # Intra-process publishers only support the keep_last history
+                parameters=[params_file_path, {'qos_history_policy': 'keep_last'}],
+                extra_arguments=[{'use_intra_process_comms': True}]),
+            ComposableNode(
+                package='vicon2_driver',
+                plugin='ViconPoseConsumer',
+                name='vicon2_pose_consumer',
+                parameters=[{'odom_topic': odom_topic}],
+                extra_arguments=[{'use_intra_process_comms': True}]),
+        ],
+        output='screen',
+    )
+
+    # Composable nodes can not be matched by lifecycle events, so the driver
+    # transitions are requested through the lifecycle services once it is loaded
+    driver_configure_cmd = TimerAction(
+        period=2.0,
+        actions=[ExecuteProcess(
+            cmd=['ros2', 'lifecycle', 'set', '/vicon2_driver_node', 'configure'],
+            output='screen')]
+    )
+
+    driver_activate_cmd = TimerAction(
+        period=4.0,
+        actions=[ExecuteProcess(
+            cmd=['ros2', 'lifecycle', 'set', '/vicon2_driver_node', 'activate'],
+            output='screen')]
+    )
+
+    # Create the launch description and populate
+    ld = LaunchDescription()
+
+    ld.add_action(declare_odom_topic_cmd)
+    ld.add_action(container)
+    ld.add_action(driver_configure_cmd)
+    ld.add_action(driver_activate_cmd)
+
+    return ld
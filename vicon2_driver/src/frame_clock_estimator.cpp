@@ -0,0 +1,192 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "vicon2_driver/frame_clock_estimator.hpp"
+
+// Samples needed before the fit is used to stamp frames
+static const size_t kMinValidSamples = 20;
+// Lower bound of the deviation used for outlier rejection, so a near perfect fit
+// does not end up rejecting every new sample
+static const double kMinSigma = 20e-6;
+
+FrameClockEstimator::FrameClockEstimator(
+  size_t window_size, double outlier_threshold, double max_drift_ppm)
+: window_size_(std::max(window_size, kMinValidSamples)),
+  outlier_threshold_(outlier_threshold),
+  max_drift_ppm_(max_drift_ppm),
+  nominal_period_(0.0),
+  rejected_count_(0),
+  reset_count_(0)
+{
+  frames_.reserve(window_size_);
+  times_.reserve(window_size_);
+  residuals_.reserve(window_size_);
+  reset();
+}
+
+void FrameClockEstimator::reset()
+{
+  frames_.clear();
+  times_.clear();
+  next_ = 0;
+  ref_frame_ = 0;
+  ref_time_ns_ = 0;
+  last_frame_ = 0;
+  offset_ = 0.0;
+  period_ = nominal_period_;
+  rms_residual_ = 0.0;
+  max_residual_ = 0.0;
+  last_residual_ = 0.0;
+  consecutive_rejections_ = 0;
+}
+
+void FrameClockEstimator::set_nominal_rate(double rate_hz)
+{
+  nominal_period_ = rate_hz > 0.0 ? 1.0 / rate_hz : 0.0;
+  if (frames_.size() < 2) {
+    period_ = nominal_period_;
+  }
+}
+
+bool FrameClockEstimator::add_sample(uint64_t hardware_frame, int64_t host_time_ns)
+{
+  if (!frames_.empty() && hardware_frame <= last_frame_) {
+    if (hardware_frame == last_frame_) {
+      return true;
+    }
+    // The frame counter went back (server restarted), the old fit is meaningless
+    reset();
+    reset_count_++;
+  }
+
+  if (frames_.empty()) {
+    ref_frame_ = hardware_frame;
+    ref_time_ns_ = host_time_ns;
+  }
+
+  double x = static_cast<double>(hardware_frame - ref_frame_);
+  double y = static_cast<double>(host_time_ns - ref_time_ns_) * 1e-9;
+
+  if (is_valid()) {
+    last_residual_ = y - (offset_ + period_ * x);
+    if (std::fabs(last_residual_) > outlier_threshold_ * robust_sigma()) {
+      rejected_count_++;
+      consecutive_rejections_++;
+      if (consecutive_rejections_ < window_size_ / 4) {
+        return false;
+      }
+      // Too many rejections in a row: the host clock stepped, start again from this sample
+      reset();
+      reset_count_++;
+      ref_frame_ = hardware_frame;
+      ref_time_ns_ = host_time_ns;
+      x = 0.0;
+      y = 0.0;
+    }
+  }
+  consecutive_rejections_ = 0;
+
+  if (frames_.size() < window_size_) {
+    frames_.push_back(x);
+    times_.push_back(y);
+  } else {
+    frames_[next_] = x;
+    times_[next_] = y;
+    next_ = (next_ + 1) % window_size_;
+  }
+  last_frame_ = hardware_frame;
+
+  fit();
+
+  // The slope is only checked with a full window, short windows are dominated by jitter
+  if (frames_.size() == window_size_ && nominal_period_ > 0.0 &&
+    std::fabs(drift_ppm()) > max_drift_ppm_)
+  {
+    // The fitted rate can not be explained by clock drift, restart from this sample
+    reset();
+    reset_count_++;
+    return add_sample(hardware_frame, host_time_ns);
+  }
+  return true;
+}
+
+int64_t FrameClockEstimator::stamp(uint64_t hardware_frame) const
+{
+  double x = static_cast<double>(static_cast<int64_t>(hardware_frame - ref_frame_));
+  return ref_time_ns_ + static_cast<int64_t>(std::llround((offset_ + period_ * x) * 1e9));
+}
+
+bool FrameClockEstimator::is_valid() const
+{
+  return frames_.size() >= kMinValidSamples;
+}
+
+double FrameClockEstimator::drift_ppm() const
+{
+  if (nominal_period_ <= 0.0 || frames_.size() < 2) {
+    return 0.0;
+  }
+  return (period_ / nominal_period_ - 1.0) * 1e6;
+}
+
+void FrameClockEstimator::fit()
+{
+  const size_t n = frames_.size();
+  double mx = 0.0, my = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    mx += frames_[i];
+    my += times_[i];
+  }
+  mx /= n;
+  my /= n;
+
+  double sxx = 0.0, sxy = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double dx = frames_[i] - mx;
+    sxx += dx * dx;
+    sxy += dx * (times_[i] - my);
+  }
+
+  if (n >= 2 && sxx > 0.0) {
+    period_ = sxy / sxx;
+  } else {
+    period_ = nominal_period_;
+  }
+  offset_ = my - period_ * mx;
+
+  double sum_sq = 0.0;
+  max_residual_ = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double residual = times_[i] - (offset_ + period_ * frames_[i]);
+    sum_sq += residual * residual;
+    max_residual_ = std::max(max_residual_, std::fabs(residual));
+  }
+  rms_residual_ = std::sqrt(sum_sq / n);
+}
+
+// Standard deviation estimated from the median absolute residual of the window
+double FrameClockEstimator::robust_sigma() const
+{
+  const size_t n = frames_.size();
+  residuals_.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    residuals_[i] = std::fabs(times_[i] - (offset_ + period_ * frames_[i]));
+  }
+  std::nth_element(residuals_.begin(), residuals_.begin() + n / 2, residuals_.end());
+  return std::max(1.4826 * residuals_[n / 2], kMinSigma);
+}
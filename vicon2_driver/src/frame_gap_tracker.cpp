@@ -0,0 +1,133 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "vicon2_driver/frame_gap_tracker.hpp"
+
+FrameGapTracker::FrameGapTracker(uint32_t max_gap)
+: max_gap_(max_gap),
+  has_last_(false),
+  last_frame_number_(0),
+  last_dropped_(0),
+  received_(0),
+  expected_(0),
+  dropped_(0),
+  gaps_(0),
+  resets_(0),
+  duplicates_(0)
+{
+  histogram_.fill(0);
+}
+
+void FrameGapTracker::set_window_sizes(const std::vector<size_t> & sizes)
+{
+  windows_.resize(sizes.size());
+  for (size_t i = 0; i < sizes.size(); i++) {
+    Window & window = windows_[i];
+    window.dropped.assign(sizes[i] > 0 ? sizes[i] : 1, 0);
+    window.next = 0;
+    window.filled = 0;
+    window.sum = 0;
+  }
+}
+
+FrameGapTracker::Result FrameGapTracker::update(uint32_t frame_number)
+{
+  last_dropped_ = 0;
+
+  if (!has_last_) {
+    has_last_ = true;
+    last_frame_number_ = frame_number;
+    received_++;
+    expected_++;
+    push(0);
+    return FIRST;
+  }
+
+  if (frame_number == last_frame_number_) {
+    duplicates_++;
+    return DUPLICATE;
+  }
+
+  if (frame_number < last_frame_number_ || frame_number - last_frame_number_ > max_gap_) {
+    resets_++;
+    last_frame_number_ = frame_number;
+    received_++;
+    expected_++;
+    push(0);
+    return RESET;
+  }
+
+  uint32_t diff = frame_number - last_frame_number_;
+  last_frame_number_ = frame_number;
+  last_dropped_ = diff - 1;
+  received_++;
+  expected_ += diff;
+  push(last_dropped_);
+
+  if (last_dropped_ == 0) {
+    return NEXT;
+  }
+
+  dropped_ += last_dropped_;
+  gaps_++;
+  size_t bin = 0;
+  while (bin < kHistogramBins - 1 && (static_cast<uint32_t>(1) << bin) < last_dropped_) {
+    bin++;
+  }
+  histogram_[bin]++;
+  return GAP;
+}
+
+double FrameGapTracker::drop_pct() const
+{
+  return expected_ > 0 ? 100.0 * dropped_ / expected_ : 0.0;
+}
+
+double FrameGapTracker::window_drop_pct(size_t i) const
+{
+  const Window & window = windows_[i];
+  uint64_t expected = window.filled + window.sum;
+  return expected > 0 ? 100.0 * window.sum / expected : 0.0;
+}
+
+std::string FrameGapTracker::histogram_label(size_t bin)
+{
+  if (bin == 0) {
+    return "1";
+  }
+  if (bin == 1) {
+    return "2";
+  }
+  if (bin >= kHistogramBins - 1) {
+    return ">" + std::to_string(1u << (kHistogramBins - 2));
+  }
+  return std::to_string((1u << (bin - 1)) + 1) + "-" + std::to_string(1u << bin);
+}
+
+void FrameGapTracker::push(uint32_t dropped)
+{
+  for (auto & window : windows_) {
+    if (window.filled == window.dropped.size()) {
+      window.sum -= window.dropped[window.next];
+    } else {
+      window.filled++;
+    }
+    window.dropped[window.next] = dropped;
+    window.sum += dropped;
+    window.next = (window.next + 1) % window.dropped.size();
+  }
+}
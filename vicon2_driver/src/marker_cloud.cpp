@@ -0,0 +1,73 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <limits>
+
+#include "vicon2_driver/marker_cloud.hpp"
+
+namespace
+{
+
+const uint32_t kLabelOffset = 12;
+const uint32_t kOccludedOffset = 16;
+const uint32_t kPointStep = 20;
+
+sensor_msgs::msg::PointField point_field(const char * name, uint32_t offset, uint8_t datatype)
+{
+  sensor_msgs::msg::PointField field;
+  field.name = name;
+  field.offset = offset;
+  field.datatype = datatype;
+  field.count = 1;
+  return field;
+}
+
+}  // namespace
+
+void init_marker_cloud(sensor_msgs::msg::PointCloud2 & cloud, size_t n_points)
+{
+  if (cloud.fields.empty()) {
+    cloud.fields.push_back(point_field("x", 0, sensor_msgs::msg::PointField::FLOAT32));
+    cloud.fields.push_back(point_field("y", 4, sensor_msgs::msg::PointField::FLOAT32));
+    cloud.fields.push_back(point_field("z", 8, sensor_msgs::msg::PointField::FLOAT32));
+    cloud.fields.push_back(
+      point_field("label", kLabelOffset, sensor_msgs::msg::PointField::INT32));
+    cloud.fields.push_back(
+      point_field("occluded", kOccludedOffset, sensor_msgs::msg::PointField::UINT8));
+  }
+  cloud.height = 1;
+  cloud.width = static_cast<uint32_t>(n_points);
+  cloud.is_bigendian = false;
+  cloud.point_step = kPointStep;
+  cloud.row_step = kPointStep * cloud.width;
+  cloud.is_dense = false;
+  cloud.data.resize(cloud.row_step);
+}
+
+void set_marker_point(
+  sensor_msgs::msg::PointCloud2 & cloud, size_t index, const double translation[3],
+  int32_t label, bool occluded)
+{
+  uint8_t * point = cloud.data.data() + index * kPointStep;
+  float xyz[3];
+  for (int i = 0; i < 3; i++) {
+    xyz[i] = occluded ? std::numeric_limits<float>::quiet_NaN() :
+      static_cast<float>(translation[i] / 1000.0);
+  }
+  uint8_t occluded_flag = occluded ? 1 : 0;
+  std::memcpy(point, xyz, sizeof(xyz));
+  std::memcpy(point + kLabelOffset, &label, sizeof(label));
+  std::memcpy(point + kOccludedOffset, &occluded_flag, sizeof(occluded_flag));
+}
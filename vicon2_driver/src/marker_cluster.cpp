@@ -0,0 +1,448 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "vicon2_driver/marker_cluster.hpp"
+
+const size_t MarkerCluster::kMaxMarkers;
+const size_t MarkerCluster::kNone;
+const unsigned int MarkerCluster::kMaxAcquireSolutions;
+
+// Eigenvalues (diagonal of a) and eigenvectors (columns of v) of the symmetric matrix a
+static void symmetric_eigen4(double a[4][4], double v[4][4])
+{
+  for (int row = 0; row < 4; row++) {
+    for (int col = 0; col < 4; col++) {
+      v[row][col] = row == col ? 1.0 : 0.0;
+    }
+  }
+  for (int sweep = 0; sweep < 32; sweep++) {
+    double off = 0.0, scale = 0.0;
+    for (int p = 0; p < 4; p++) {
+      scale += a[p][p] * a[p][p];
+      for (int q = p + 1; q < 4; q++) {
+        off += a[p][q] * a[p][q];
+      }
+    }
+    if (off <= 1e-30 * scale || off == 0.0) {
+      return;
+    }
+    for (int p = 0; p < 3; p++) {
+      for (int q = p + 1; q < 4; q++) {
+        if (a[p][q] == 0.0) {
+          continue;
+        }
+        double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+        double t =
+          (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+        double c = 1.0 / std::sqrt(t * t + 1.0);
+        double s = t * c;
+        for (int k = 0; k < 4; k++) {
+          double akp = a[k][p], akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < 4; k++) {
+          double apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < 4; k++) {
+          double vkp = v[k][p], vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+}
+
+// v rotated by the unit quaternion q (x, y, z, w)
+static void rotate(const double q[4], const double v[3], double r[3])
+{
+  // r = v + 2 w (u x v) + 2 u x (u x v), with u the vector part of q
+  double cx = q[1] * v[2] - q[2] * v[1];
+  double cy = q[2] * v[0] - q[0] * v[2];
+  double cz = q[0] * v[1] - q[1] * v[0];
+  r[0] = v[0] + 2.0 * (q[3] * cx + q[1] * cz - q[2] * cy);
+  r[1] = v[1] + 2.0 * (q[3] * cy + q[2] * cx - q[0] * cz);
+  r[2] = v[2] + 2.0 * (q[3] * cz + q[0] * cy - q[1] * cx);
+}
+
+bool solve_rigid_transform(
+  const double * model, const double * observed, size_t n, double position[3],
+  double orientation[4], double & residual)
+{
+  if (n < 3) {
+    return false;
+  }
+  double model_center[3] = {0.0, 0.0, 0.0}, observed_center[3] = {0.0, 0.0, 0.0};
+  for (size_t i = 0; i < n; i++) {
+    for (int k = 0; k < 3; k++) {
+      model_center[k] += model[i * 3 + k] / n;
+      observed_center[k] += observed[i * 3 + k] / n;
+    }
+  }
+
+  // Cross covariance s[a][b] = sum of model a * observed b, centered
+  double s[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+  for (size_t i = 0; i < n; i++) {
+    double m[3], o[3];
+    for (int k = 0; k < 3; k++) {
+      m[k] = model[i * 3 + k] - model_center[k];
+      o[k] = observed[i * 3 + k] - observed_center[k];
+    }
+    for (int row = 0; row < 3; row++) {
+      for (int col = 0; col < 3; col++) {
+        s[row][col] += m[row] * o[col];
+      }
+    }
+  }
+
+  // Horn's matrix, in (w, x, y, z) order
+  double a[4][4] = {
+    {s[0][0] + s[1][1] + s[2][2], s[1][2] - s[2][1], s[2][0] - s[0][2], s[0][1] - s[1][0]},
+    {s[1][2] - s[2][1], s[0][0] - s[1][1] - s[2][2], s[0][1] + s[1][0], s[2][0] + s[0][2]},
+    {s[2][0] - s[0][2], s[0][1] + s[1][0], -s[0][0] + s[1][1] - s[2][2], s[1][2] + s[2][1]},
+    {s[0][1] - s[1][0], s[2][0] + s[0][2], s[1][2] + s[2][1], -s[0][0] - s[1][1] + s[2][2]}};
+  double v[4][4];
+  symmetric_eigen4(a, v);
+
+  int largest = 0, second = -1;
+  for (int i = 1; i < 4; i++) {
+    if (a[i][i] > a[largest][largest]) {
+      largest = i;
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    if (i != largest && (second < 0 || a[i][i] > a[second][second])) {
+      second = i;
+    }
+  }
+  // Collinear (or coincident) points leave the two largest eigenvalues equal
+  double spread = 0.0;
+  for (int i = 0; i < 4; i++) {
+    spread = std::max(spread, std::fabs(a[i][i]));
+  }
+  if (a[largest][largest] - a[second][second] <= 1e-9 * spread) {
+    return false;
+  }
+
+  orientation[0] = v[1][largest];
+  orientation[1] = v[2][largest];
+  orientation[2] = v[3][largest];
+  orientation[3] = v[0][largest];
+  double norm = std::sqrt(
+    orientation[0] * orientation[0] + orientation[1] * orientation[1] +
+    orientation[2] * orientation[2] + orientation[3] * orientation[3]);
+  double sign = orientation[3] < 0.0 ? -1.0 : 1.0;
+  for (int k = 0; k < 4; k++) {
+    orientation[k] *= sign / norm;
+  }
+
+  double rotated[3];
+  rotate(orientation, model_center, rotated);
+  for (int k = 0; k < 3; k++) {
+    position[k] = observed_center[k] - rotated[k];
+  }
+
+  double squared_error = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    rotate(orientation, &model[i * 3], rotated);
+    for (int k = 0; k < 3; k++) {
+      double error = rotated[k] + position[k] - observed[i * 3 + k];
+      squared_error += error * error;
+    }
+  }
+  residual = std::sqrt(squared_error / n);
+  return true;
+}
+
+MarkerCluster::MarkerCluster()
+: n_markers_(0),
+  max_residual_(1.0),
+  tolerance_(2.0),
+  has_model_(false),
+  acquire_solutions_(0),
+  extent_(0.0),
+  solved_(false),
+  residual_(0.0),
+  used_(0)
+{
+  std::fill(position_, position_ + 3, 0.0);
+  std::fill(orientation_, orientation_ + 3, 0.0);
+  orientation_[3] = 1.0;
+  reset();
+}
+
+bool MarkerCluster::configure(
+  const std::string & name, const std::vector<std::string> & marker_names,
+  const std::vector<double> & positions, double max_residual, std::string & error)
+{
+  name_ = name;
+  marker_names_ = marker_names;
+  n_markers_ = marker_names.empty() ? positions.size() / 3 : marker_names.size();
+  max_residual_ = max_residual > 0.0 ? max_residual : 1.0;
+  tolerance_ = 2.0 * max_residual_;
+  has_model_ = false;
+  solved_ = false;
+  reset();
+
+  if (marker_names.empty() && positions.empty()) {
+    error = "needs the positions of its markers, or their names";
+    return false;
+  }
+  if (!positions.empty() && positions.size() != n_markers_ * 3) {
+    error = "needs 3 positions (x, y, z) per marker";
+    return false;
+  }
+  if (n_markers_ < 3 || n_markers_ > kMaxMarkers) {
+    error = "needs 3 to " + std::to_string(kMaxMarkers) + " markers";
+    return false;
+  }
+  if (!positions.empty()) {
+    set_model(positions.data());
+  }
+  return true;
+}
+
+void MarkerCluster::reset()
+{
+  for (size_t k = 0; k < kMaxMarkers; k++) {
+    bound_[k] = false;
+    bound_id_[k] = 0;
+  }
+  solved_ = false;
+}
+
+void MarkerCluster::set_model(const double * positions)
+{
+  std::copy(positions, positions + n_markers_ * 3, model_);
+  for (size_t i = 0; i < n_markers_; i++) {
+    for (size_t j = 0; j < n_markers_; j++) {
+      double distance2 = 0.0;
+      for (int k = 0; k < 3; k++) {
+        double d = model_[i * 3 + k] - model_[j * 3 + k];
+        distance2 += d * d;
+      }
+      model_distance_[i][j] = std::sqrt(distance2);
+    }
+  }
+  extent_ = *std::max_element(model_distance_[0], model_distance_[0] + n_markers_) + tolerance_;
+  has_model_ = true;
+}
+
+bool MarkerCluster::fit(const double * positions, const size_t * index)
+{
+  size_t n = 0;
+  for (size_t k = 0; k < n_markers_; k++) {
+    if (index[k] == kNone) {
+      continue;
+    }
+    for (int i = 0; i < 3; i++) {
+      fit_model_[n * 3 + i] = model_[k * 3 + i];
+      fit_observed_[n * 3 + i] = positions[index[k] * 3 + i];
+    }
+    n++;
+  }
+  double position[3], orientation[4], residual;
+  if (!solve_rigid_transform(fit_model_, fit_observed_, n, position, orientation, residual) ||
+    residual > max_residual_)
+  {
+    return false;
+  }
+  std::copy(position, position + 3, position_);
+  std::copy(orientation, orientation + 4, orientation_);
+  residual_ = residual;
+  used_ = n;
+  return true;
+}
+
+bool MarkerCluster::solve_labeled(const double * positions, const bool * seen)
+{
+  size_t index[kMaxMarkers];
+  if (!has_model_) {
+    // The model is taken from the first frame with all the markers
+    if (!std::all_of(seen, seen + n_markers_, [](bool s) {return s;})) {
+      solved_ = false;
+      return false;
+    }
+    double center[3] = {0.0, 0.0, 0.0};
+    for (size_t k = 0; k < n_markers_; k++) {
+      for (int i = 0; i < 3; i++) {
+        center[i] += positions[k * 3 + i] / n_markers_;
+      }
+    }
+    double model[kMaxMarkers * 3] = {0.0};
+    for (size_t k = 0; k < n_markers_; k++) {
+      for (int i = 0; i < 3; i++) {
+        model[k * 3 + i] = positions[k * 3 + i] - center[i];
+      }
+    }
+    set_model(model);
+  }
+  for (size_t k = 0; k < n_markers_; k++) {
+    index[k] = seen[k] ? k : kNone;
+  }
+  solved_ = fit(positions, index);
+  return solved_;
+}
+
+bool MarkerCluster::solve_unlabeled(const double * positions, const uint32_t * ids, size_t n)
+{
+  size_t index[kMaxMarkers];
+  size_t found = 0;
+  for (size_t k = 0; k < n_markers_; k++) {
+    index[k] = kNone;
+    if (!ids || !bound_[k]) {
+      continue;
+    }
+    for (size_t j = 0; j < n; j++) {
+      if (ids[j] == bound_id_[k]) {
+        index[k] = j;
+        found++;
+        break;
+      }
+    }
+  }
+  bool fitted = found >= 3 && fit(positions, index);
+  if (!fitted) {
+    std::fill(index, index + n_markers_, kNone);
+    found = 0;
+  }
+
+  // The markers not found by id, near where the new (or else the last) solution puts them
+  if ((fitted || solved_) && found < n_markers_) {
+    size_t previous[kMaxMarkers];
+    std::copy(index, index + n_markers_, previous);
+    size_t added = 0;
+    for (size_t k = 0; k < n_markers_; k++) {
+      if (index[k] != kNone) {
+        continue;
+      }
+      double predicted[3];
+      rotate(orientation_, &model_[k * 3], predicted);
+      double best = tolerance_ * tolerance_;
+      for (size_t j = 0; j < n; j++) {
+        double distance2 = 0.0;
+        for (int i = 0; i < 3; i++) {
+          double d = positions[j * 3 + i] - predicted[i] - position_[i];
+          distance2 += d * d;
+        }
+        if (distance2 < best && std::find(index, index + n_markers_, j) == index + n_markers_) {
+          best = distance2;
+          index[k] = j;
+        }
+      }
+      if (index[k] != kNone) {
+        added++;
+      }
+    }
+    if (added > 0 && found + added >= 3 && !fit(positions, index)) {
+      // A wrong marker was taken, keep the solution from the markers found by id
+      std::copy(previous, previous + n_markers_, index);
+      added = 0;
+    }
+    fitted = fitted || (added > 0 && found + added >= 3);
+  }
+
+  if (!fitted) {
+    std::fill(index, index + n_markers_, kNone);
+    fitted = n >= n_markers_ && acquire(positions, n, index);
+  }
+  solved_ = fitted;
+  if (solved_) {
+    for (size_t k = 0; k < n_markers_; k++) {
+      bound_[k] = ids && index[k] != kNone;
+      if (bound_[k]) {
+        bound_id_[k] = ids[index[k]];
+      }
+    }
+  }
+  return solved_;
+}
+
+bool MarkerCluster::acquire(const double * positions, size_t n, size_t * index)
+{
+  by_x_.resize(n);
+  for (size_t j = 0; j < n; j++) {
+    by_x_[j] = std::make_pair(positions[j * 3], j);
+  }
+  std::sort(by_x_.begin(), by_x_.end());
+  acquire_solutions_ = 0;
+
+  // Every marker as the first one of the model, the others within extent_ along x
+  size_t begin = 0, end = 0;
+  for (size_t first = 0; first < n; first++) {
+    double x = by_x_[first].first;
+    while (by_x_[begin].first < x - extent_) {
+      begin++;
+    }
+    while (end < n && by_x_[end].first <= x + extent_) {
+      end++;
+    }
+    index[0] = by_x_[first].second;
+    if (search(positions, begin, end, 1, index)) {
+      return true;
+    }
+    if (acquire_solutions_ >= kMaxAcquireSolutions) {
+      break;
+    }
+  }
+  index[0] = kNone;
+  return false;
+}
+
+bool MarkerCluster::search(
+  const double * positions, size_t begin, size_t end, size_t k, size_t * index)
+{
+  if (k == n_markers_) {
+    acquire_solutions_++;
+    return fit(positions, index);
+  }
+  for (size_t candidate = begin; candidate < end; candidate++) {
+    size_t j = by_x_[candidate].second;
+    bool match = true;
+    for (size_t i = 0; i < k && match; i++) {
+      if (index[i] == j) {
+        match = false;
+        break;
+      }
+      double distance2 = 0.0;
+      for (int c = 0; c < 3; c++) {
+        double d = positions[j * 3 + c] - positions[index[i] * 3 + c];
+        distance2 += d * d;
+      }
+      double low = std::max(model_distance_[k][i] - tolerance_, 0.0);
+      double high = model_distance_[k][i] + tolerance_;
+      match = distance2 >= low * low && distance2 <= high * high;
+    }
+    if (!match) {
+      continue;
+    }
+    index[k] = j;
+    if (search(positions, begin, end, k + 1, index)) {
+      return true;
+    }
+    if (acquire_solutions_ >= kMaxAcquireSolutions) {
+      break;
+    }
+  }
+  index[k] = kNone;
+  return false;
+}
@@ -0,0 +1,228 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "vicon2_driver/marker_tracker.hpp"
+
+const size_t MarkerTracker::kMaxCandidates;
+
+MarkerTracker::MarkerTracker()
+: gate_(20.0),
+  cell_scale_(0.5 / 20.0),
+  max_missed_(5),
+  next_id_(0),
+  started_(0)
+{}
+
+void MarkerTracker::configure(double gate, uint32_t max_missed)
+{
+  gate_ = gate > 0.0 ? gate : 1.0;
+  cell_scale_ = 0.5 / gate_;
+  max_missed_ = max_missed;
+  started_ = 0;
+  reset();
+}
+
+void MarkerTracker::reset()
+{
+  next_id_ = 0;
+  id_.clear();
+  missed_.clear();
+  last_time_.clear();
+  position_.clear();
+  velocity_.clear();
+  predicted_.clear();
+}
+
+// Cells twice the gate: the gate around a position overlaps 2 of them per axis
+int64_t MarkerTracker::cell(double value) const
+{
+  return static_cast<int64_t>(std::floor(value * cell_scale_));
+}
+
+// 21 bits per axis. Cells far enough apart to share a key only add candidates, which are
+// checked against the gate anyway.
+uint64_t MarkerTracker::cell_key(int64_t ix, int64_t iy, int64_t iz) const
+{
+  const uint64_t mask = (1u << 21) - 1;
+  return ((static_cast<uint64_t>(ix) & mask) << 42) | ((static_cast<uint64_t>(iy) & mask) << 21) |
+         (static_cast<uint64_t>(iz) & mask);
+}
+
+size_t MarkerTracker::cell_slot(uint64_t key) const
+{
+  size_t mask = cells_.size() - 1;
+  uint64_t hash = (key ^ (key >> 29)) * 0x9E3779B97F4A7C15ull;
+  size_t slot = static_cast<size_t>(hash >> 40) & mask;
+  while (cells_[slot].end != 0 && cells_[slot].key != key) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+// The ranges of grid_ (sorted) of every cell, in a table at most a quarter full
+void MarkerTracker::build_cells()
+{
+  size_t size = 16;
+  while (size < 4 * grid_.size()) {
+    size *= 2;
+  }
+  cells_.assign(size, Cell());
+  for (size_t i = 0; i < grid_.size(); ) {
+    size_t end = i + 1;
+    while (end < grid_.size() && grid_[end].first == grid_[i].first) {
+      end++;
+    }
+    Cell & cell = cells_[cell_slot(grid_[i].first)];
+    cell.key = grid_[i].first;
+    cell.begin = static_cast<uint32_t>(i);
+    cell.end = static_cast<uint32_t>(end);
+    i = end;
+  }
+}
+
+void MarkerTracker::start_track(double t, const double position[3])
+{
+  id_.push_back(next_id_++);
+  missed_.push_back(0);
+  last_time_.push_back(t);
+  for (int i = 0; i < 3; i++) {
+    position_.push_back(position[i]);
+    velocity_.push_back(0.0);
+    predicted_.push_back(position[i]);
+  }
+  started_++;
+}
+
+void MarkerTracker::update(
+  double t, const double * positions, size_t n_markers, std::vector<uint32_t> & ids)
+{
+  const double gate2 = gate_ * gate_;
+  size_t n_tracks = id_.size();
+
+  // Tracks at their predicted position, sorted by cell
+  grid_.resize(n_tracks);
+  for (size_t track = 0; track < n_tracks; track++) {
+    double dt = t - last_time_[track];
+    double * predicted = &predicted_[track * 3];
+    for (int i = 0; i < 3; i++) {
+      predicted[i] = position_[track * 3 + i] + velocity_[track * 3 + i] * dt;
+    }
+    grid_[track] = std::make_pair(
+      cell_key(cell(predicted[0]), cell(predicted[1]), cell(predicted[2])),
+      static_cast<uint32_t>(track));
+  }
+  std::sort(grid_.begin(), grid_.end());
+  build_cells();
+
+  // The closest tracks within the gate of every marker, from the 8 cells its gate overlaps
+  candidates_.clear();
+  for (size_t marker = 0; marker < n_markers; marker++) {
+    const double * position = &positions[marker * 3];
+    int64_t first[3];
+    for (int i = 0; i < 3; i++) {
+      first[i] = cell(position[i] - gate_);
+    }
+    Candidate best[kMaxCandidates];
+    size_t n_best = 0;
+    for (int64_t dx = 0; dx <= 1; dx++) {
+      for (int64_t dy = 0; dy <= 1; dy++) {
+        for (int64_t dz = 0; dz <= 1; dz++) {
+          const Cell & cell =
+            cells_[cell_slot(cell_key(first[0] + dx, first[1] + dy, first[2] + dz))];
+          for (uint32_t i = cell.begin; i < cell.end; i++) {
+            uint32_t track = grid_[i].second;
+            const double * predicted = &predicted_[track * 3];
+            double ex = position[0] - predicted[0];
+            double ey = position[1] - predicted[1];
+            double ez = position[2] - predicted[2];
+            double distance2 = ex * ex + ey * ey + ez * ez;
+            if (distance2 > gate2 ||
+              (n_best == kMaxCandidates && distance2 >= best[n_best - 1].distance2))
+            {
+              continue;
+            }
+            // Insertion in the sorted best list
+            size_t slot = n_best < kMaxCandidates ? n_best++ : n_best - 1;
+            while (slot > 0 && best[slot - 1].distance2 > distance2) {
+              best[slot] = best[slot - 1];
+              slot--;
+            }
+            best[slot].distance2 = distance2;
+            best[slot].marker = static_cast<uint32_t>(marker);
+            best[slot].track = track;
+          }
+        }
+      }
+    }
+    candidates_.insert(candidates_.end(), best, best + n_best);
+  }
+  std::sort(candidates_.begin(), candidates_.end());
+
+  // Closest pairs first
+  const uint32_t kUnassigned = UINT32_MAX;
+  ids.assign(n_markers, kUnassigned);
+  track_matched_.assign(n_tracks, 0);
+  for (const Candidate & candidate : candidates_) {
+    if (ids[candidate.marker] != kUnassigned || track_matched_[candidate.track]) {
+      continue;
+    }
+    size_t track = candidate.track;
+    const double * position = &positions[candidate.marker * 3];
+    double dt = t - last_time_[track];
+    for (int i = 0; i < 3; i++) {
+      velocity_[track * 3 + i] = dt > 0.0 ? (position[i] - position_[track * 3 + i]) / dt : 0.0;
+      position_[track * 3 + i] = position[i];
+    }
+    last_time_[track] = t;
+    missed_[track] = 0;
+    track_matched_[track] = 1;
+    ids[candidate.marker] = id_[track];
+  }
+
+  // Tracks without a marker are dropped after max_missed frames, keeping the order
+  size_t kept = 0;
+  for (size_t track = 0; track < n_tracks; track++) {
+    if (!track_matched_[track] && ++missed_[track] > max_missed_) {
+      continue;
+    }
+    if (kept != track) {
+      id_[kept] = id_[track];
+      missed_[kept] = missed_[track];
+      last_time_[kept] = last_time_[track];
+      for (int i = 0; i < 3; i++) {
+        position_[kept * 3 + i] = position_[track * 3 + i];
+        velocity_[kept * 3 + i] = velocity_[track * 3 + i];
+      }
+    }
+    kept++;
+  }
+  id_.resize(kept);
+  missed_.resize(kept);
+  last_time_.resize(kept);
+  position_.resize(kept * 3);
+  velocity_.resize(kept * 3);
+  predicted_.resize(kept * 3);
+
+  for (size_t marker = 0; marker < n_markers; marker++) {
+    if (ids[marker] == kUnassigned) {
+      ids[marker] = next_id_;
+      start_track(t, &positions[marker * 3]);
+    }
+  }
+}
@@ -0,0 +1,75 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vicon2_driver/pose_extrapolator.hpp"
+#include "vicon2_driver/pose_prediction.hpp"
+#include "vicon2_driver/quaternion_utils.hpp"
+
+PoseExtrapolator::PoseExtrapolator()
+{
+  reset();
+}
+
+void PoseExtrapolator::reset()
+{
+  n_poses_ = 0;
+  last_time_ = 0.0;
+  for (int i = 0; i < 3; i++) {
+    position_[i] = 0.0;
+    velocity_[i] = 0.0;
+    angular_velocity_[i] = 0.0;
+    orientation_[i] = 0.0;
+  }
+  orientation_[3] = 1.0;
+}
+
+void PoseExtrapolator::update(double t, const double position[3], const double orientation[4])
+{
+  double dt = t - last_time_;
+  if (n_poses_ > 0 && dt > 0.0) {
+    for (int i = 0; i < 3; i++) {
+      velocity_[i] = (position[i] - position_[i]) / dt;
+    }
+
+    double rotation[3];
+    quaternion_delta(orientation_, orientation, rotation);
+    for (int i = 0; i < 3; i++) {
+      angular_velocity_[i] = rotation[i] / dt;
+    }
+    n_poses_ = 2;
+  } else if (n_poses_ == 0) {
+    n_poses_ = 1;
+  }
+
+  last_time_ = t;
+  for (int i = 0; i < 3; i++) {
+    position_[i] = position[i];
+  }
+  for (int i = 0; i < 4; i++) {
+    orientation_[i] = orientation[i];
+  }
+}
+
+bool PoseExtrapolator::predict(
+  double t, double max_gap, double position[3], double orientation[4]) const
+{
+  double horizon = t - last_time_;
+  if (n_poses_ < 2 || horizon < 0.0 || horizon > max_gap) {
+    return false;
+  }
+
+  predict_pose(
+    position_, orientation_, velocity_, angular_velocity_, horizon, position, orientation);
+  return true;
+}
@@ -0,0 +1,105 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+
+#include "vicon2_driver/pose_jump_filter.hpp"
+
+PoseJumpFilter::PoseJumpFilter()
+: max_linear_velocity_(10.0),
+  max_angular_velocity_(30.0),
+  max_rejected_(10),
+  flipped_(0),
+  rejected_(0)
+{}
+
+void PoseJumpFilter::configure(
+  double max_linear_velocity, double max_angular_velocity, uint32_t max_rejected)
+{
+  max_linear_velocity_ = max_linear_velocity;
+  max_angular_velocity_ = max_angular_velocity;
+  max_rejected_ = max_rejected;
+  clear();
+}
+
+size_t PoseJumpFilter::add_body()
+{
+  size_t body = size();
+  last_time_.push_back(0.0);
+  valid_.push_back(0);
+  rejected_run_.push_back(0);
+  last_position_.insert(last_position_.end(), {0.0, 0.0, 0.0});
+  last_orientation_.insert(last_orientation_.end(), {0.0, 0.0, 0.0, 1.0});
+  return body;
+}
+
+void PoseJumpFilter::clear()
+{
+  last_time_.clear();
+  valid_.clear();
+  rejected_run_.clear();
+  last_position_.clear();
+  last_orientation_.clear();
+}
+
+PoseJumpFilter::Result PoseJumpFilter::filter(
+  size_t body, double t, const double position[3], double orientation[4])
+{
+  double * last_position = &last_position_[body * 3];
+  double * last_orientation = &last_orientation_[body * 4];
+
+  Result result = ACCEPTED;
+  if (valid_[body]) {
+    double dot = orientation[0] * last_orientation[0] + orientation[1] * last_orientation[1] +
+      orientation[2] * last_orientation[2] + orientation[3] * last_orientation[3];
+    if (dot < 0.0) {
+      for (int i = 0; i < 4; i++) {
+        orientation[i] = -orientation[i];
+      }
+      dot = -dot;
+      result = FLIPPED;
+    }
+
+    // Compared squared, and the rotation angle is 2 acos(dot)
+    double dt = t - last_time_[body];
+    double dx = position[0] - last_position[0];
+    double dy = position[1] - last_position[1];
+    double dz = position[2] - last_position[2];
+    double max_distance = max_linear_velocity_ * dt;
+    double max_angle = std::min(max_angular_velocity_ * dt, M_PI);
+    bool jump = dt <= 0.0 ||
+      dx * dx + dy * dy + dz * dz > max_distance * max_distance ||
+      dot < std::cos(max_angle / 2.0);
+    if (jump && rejected_run_[body] < max_rejected_) {
+      rejected_run_[body]++;
+      rejected_++;
+      return REJECTED;
+    }
+    if (result == FLIPPED) {
+      flipped_++;
+    }
+  }
+
+  valid_[body] = 1;
+  rejected_run_[body] = 0;
+  last_time_[body] = t;
+  for (int i = 0; i < 3; i++) {
+    last_position[i] = position[i];
+  }
+  for (int i = 0; i < 4; i++) {
+    last_orientation[i] = orientation[i];
+  }
+  return result;
+}
@@ -0,0 +1,96 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "vicon2_driver/pose_prediction.hpp"
+#include "vicon2_driver/quaternion_utils.hpp"
+
+namespace
+{
+
+double distance(const double a[3], const double b[3])
+{
+  double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Angle of the rotation between two orientations (rad)
+double angle(const double a[4], const double b[4])
+{
+  double v[3];
+  quaternion_delta(a, b, v);
+  return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+}  // namespace
+
+void predict_pose(
+  const double position[3], const double orientation[4], const double linear[3],
+  const double angular[3], double horizon, double predicted_position[3],
+  double predicted_orientation[4])
+{
+  double rotation[3], delta[4];
+  for (int i = 0; i < 3; i++) {
+    predicted_position[i] = position[i] + linear[i] * horizon;
+    rotation[i] = angular[i] * horizon;
+  }
+  rotation_vector_to_quaternion(rotation, delta);
+  quaternion_multiply(delta, orientation, predicted_orientation);
+  quaternion_normalize(predicted_orientation);
+}
+
+PredictionEvaluator::PredictionEvaluator(size_t max_pending)
+: max_pending_(max_pending)
+{}
+
+void PredictionEvaluator::add(
+  double t, const double position[3], const double orientation[4],
+  const double last_position[3], const double last_orientation[4])
+{
+  if (pending_.size() >= max_pending_) {
+    pending_.pop_front();
+  }
+  pending_.emplace_back();
+  Prediction & prediction = pending_.back();
+  prediction.t = t;
+  for (int i = 0; i < 3; i++) {
+    prediction.position[i] = position[i];
+    prediction.last_position[i] = last_position[i];
+  }
+  for (int i = 0; i < 4; i++) {
+    prediction.orientation[i] = orientation[i];
+    prediction.last_orientation[i] = last_orientation[i];
+  }
+}
+
+bool PredictionEvaluator::observe(
+  double t, double tolerance, const double position[3], const double orientation[4],
+  PredictionError & error)
+{
+  while (!pending_.empty() && pending_.front().t < t - tolerance) {
+    pending_.pop_front();
+  }
+  if (pending_.empty() || pending_.front().t > t + tolerance) {
+    return false;
+  }
+
+  const Prediction & prediction = pending_.front();
+  error.position = distance(prediction.position, position);
+  error.orientation = angle(prediction.orientation, orientation);
+  error.last_position = distance(prediction.last_position, position);
+  error.last_orientation = angle(prediction.last_orientation, orientation);
+  pending_.pop_front();
+  return true;
+}
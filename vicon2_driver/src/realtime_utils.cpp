@@ -0,0 +1,142 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vicon2_driver/realtime_utils.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+bool set_thread_realtime_priority(int priority, std::string & error)
+{
+#if defined(__linux__)
+  sched_param param;
+  param.sched_priority = priority;
+  int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (ret != 0) {
+    error = strerror(ret);
+    return false;
+  }
+  return true;
+#else
+  (void)priority;
+  error = "not supported on this platform";
+  return false;
+#endif
+}
+
+bool set_thread_cpu_affinity(const std::vector<int64_t> & cpus, std::string & error)
+{
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int64_t cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      error = "invalid CPU id " + std::to_string(cpu);
+      return false;
+    }
+    CPU_SET(static_cast<int>(cpu), &cpuset);
+  }
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  if (ret != 0) {
+    error = strerror(ret);
+    return false;
+  }
+  return true;
+#else
+  (void)cpus;
+  error = "not supported on this platform";
+  return false;
+#endif
+}
+
+std::string cpu_list_to_string(const std::vector<int64_t> & cpus)
+{
+  std::string list;
+  for (int64_t cpu : cpus) {
+    if (!list.empty()) {
+      list += ",";
+    }
+    list += std::to_string(cpu);
+  }
+  return list;
+}
+
+bool lock_process_memory(std::string & error)
+{
+#if defined(__linux__)
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    error = strerror(errno);
+    return false;
+  }
+  return true;
+#else
+  error = "not supported on this platform";
+  return false;
+#endif
+}
+
+void prefault_stack()
+{
+  const size_t stack_size = 256 * 1024;
+  volatile char stack[stack_size];
+  for (size_t i = 0; i < stack_size; i += 4096) {
+    stack[i] = 0;
+  }
+  (void)stack[0];
+}
+
+JitterStats::JitterStats()
+{
+  reset();
+}
+
+void JitterStats::add(double jitter)
+{
+  count_++;
+  sum_ += jitter;
+  sum_sq_ += jitter * jitter;
+  max_abs_ = std::max(max_abs_, std::fabs(jitter));
+}
+
+void JitterStats::reset()
+{
+  count_ = 0;
+  sum_ = 0.0;
+  sum_sq_ = 0.0;
+  max_abs_ = 0.0;
+}
+
+double JitterStats::mean() const
+{
+  return count_ > 0 ? sum_ / count_ : 0.0;
+}
+
+double JitterStats::stddev() const
+{
+  if (count_ < 2) {
+    return 0.0;
+  }
+  double m = mean();
+  return std::sqrt(std::max(0.0, sum_sq_ / count_ - m * m));
+}
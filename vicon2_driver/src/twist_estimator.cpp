@@ -0,0 +1,301 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "vicon2_driver/quaternion_utils.hpp"
+#include "vicon2_driver/twist_estimator.hpp"
+
+namespace
+{
+
+// Initial variances of the velocity and acceleration of the Kalman filter
+const double kInitialVelocityVariance = 10.0;
+const double kInitialAccelerationVariance = 100.0;
+
+}  // namespace
+
+const size_t TwistEstimator::kChannels;
+
+TwistEstimator::TwistEstimator()
+: method_(KALMAN),
+  window_(7),
+  process_noise_(50.0),
+  measurement_noise_(0.0001),
+  max_gap_(0.25)
+{}
+
+void TwistEstimator::configure(
+  Method method, size_t window, double process_noise, double measurement_noise, double max_gap)
+{
+  method_ = method;
+  window_ = window < 3 ? 3 : window;
+  process_noise_ = process_noise;
+  measurement_noise_ = measurement_noise;
+  max_gap_ = max_gap;
+  clear();
+}
+
+bool TwistEstimator::parse_method(const std::string & name, Method & method)
+{
+  if (name == "kalman") {
+    method = KALMAN;
+  } else if (name == "savitzky_golay") {
+    method = SAVITZKY_GOLAY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+size_t TwistEstimator::add_body()
+{
+  size_t body = size();
+  last_time_.push_back(0.0);
+  samples_.push_back(0);
+  seen_.push_back(0);
+  orientation_.insert(orientation_.end(), {0.0, 0.0, 0.0, 1.0});
+  size_t n = (body + 1) * kChannels;
+  for (std::vector<double> * component : {&measurement_, &rotation_, &velocity_,
+      &velocity_variance_, &x_, &v_, &a_, &p00_, &p01_, &p02_, &p11_, &p12_, &p22_})
+  {
+    component->resize(n, 0.0);
+  }
+  if (method_ == SAVITZKY_GOLAY) {
+    history_time_.resize((body + 1) * window_, 0.0);
+    history_.resize(n * window_, 0.0);
+  }
+  return body;
+}
+
+void TwistEstimator::clear()
+{
+  last_time_.clear();
+  samples_.clear();
+  seen_.clear();
+  orientation_.clear();
+  for (std::vector<double> * component : {&measurement_, &rotation_, &velocity_,
+      &velocity_variance_, &x_, &v_, &a_, &p00_, &p01_, &p02_, &p11_, &p12_, &p22_,
+      &history_time_, &history_})
+  {
+    component->clear();
+  }
+}
+
+void TwistEstimator::set_pose(size_t body, const double position[3], const double orientation[4])
+{
+  double * z = &measurement_[body * kChannels];
+  double * rotation = &rotation_[body * kChannels];
+  double * last_orientation = &orientation_[body * 4];
+
+  // The rotation vector is accumulated from the rotation between frames, so it is continuous
+  // and its derivative is the angular velocity in the world frame
+  double delta[3] = {0.0, 0.0, 0.0};
+  if (samples_[body] > 0) {
+    quaternion_delta(last_orientation, orientation, delta);
+  }
+  for (int i = 0; i < 3; i++) {
+    z[i] = position[i];
+    rotation[i] += delta[i];
+    z[3 + i] = rotation[i];
+  }
+  for (int i = 0; i < 4; i++) {
+    last_orientation[i] = orientation[i];
+  }
+  seen_[body] = 1;
+}
+
+void TwistEstimator::update(double t)
+{
+  for (size_t body = 0; body < size(); body++) {
+    if (!seen_[body]) {
+      continue;
+    }
+    seen_[body] = 0;
+
+    double dt = t - last_time_[body];
+    if (samples_[body] > 0 && (dt <= 0.0 || dt > max_gap_)) {
+      samples_[body] = 0;
+    }
+    last_time_[body] = t;
+
+    if (method_ == KALMAN) {
+      update_kalman(body, dt);
+    } else {
+      update_savitzky_golay(body, t);
+    }
+    if (samples_[body] < UINT32_MAX) {
+      samples_[body]++;
+    }
+  }
+}
+
+bool TwistEstimator::twist(
+  size_t body, double linear[3], double angular[3], double variance[6]) const
+{
+  if (body >= size() || samples_[body] < 2) {
+    return false;
+  }
+  const double * velocity = &velocity_[body * kChannels];
+  const double * velocity_variance = &velocity_variance_[body * kChannels];
+  for (int i = 0; i < 3; i++) {
+    linear[i] = velocity[i];
+    angular[i] = velocity[3 + i];
+  }
+  for (size_t i = 0; i < kChannels; i++) {
+    variance[i] = velocity_variance[i];
+  }
+  return true;
+}
+
+void TwistEstimator::update_kalman(size_t body, double dt)
+{
+  const double r = measurement_noise_;
+  size_t first = body * kChannels;
+
+  if (samples_[body] == 0) {
+    for (size_t k = first; k < first + kChannels; k++) {
+      x_[k] = measurement_[k];
+      v_[k] = 0.0;
+      a_[k] = 0.0;
+      p00_[k] = r;
+      p01_[k] = 0.0;
+      p02_[k] = 0.0;
+      p11_[k] = kInitialVelocityVariance;
+      p12_[k] = 0.0;
+      p22_[k] = kInitialAccelerationVariance;
+      velocity_[k] = 0.0;
+      velocity_variance_[k] = kInitialVelocityVariance;
+    }
+    return;
+  }
+
+  // x' = F x with F = [1 dt dt^2/2; 0 1 dt; 0 0 1], P' = F P F^T + Q for white jerk
+  const double h = dt * dt / 2.0;
+  const double dt2 = dt * dt;
+  const double dt3 = dt2 * dt;
+  const double q = process_noise_;
+  const double q00 = q * dt3 * dt2 / 20.0;
+  const double q01 = q * dt2 * dt2 / 8.0;
+  const double q02 = q * dt3 / 6.0;
+  const double q11 = q * dt3 / 3.0;
+  const double q12 = q * dt2 / 2.0;
+  const double q22 = q * dt;
+
+  for (size_t k = first; k < first + kChannels; k++) {
+    double x = x_[k] + v_[k] * dt + a_[k] * h;
+    double v = v_[k] + a_[k] * dt;
+    double a = a_[k];
+
+    // F P
+    double r00 = p00_[k] + dt * p01_[k] + h * p02_[k];
+    double r01 = p01_[k] + dt * p11_[k] + h * p12_[k];
+    double r02 = p02_[k] + dt * p12_[k] + h * p22_[k];
+    double r11 = p11_[k] + dt * p12_[k];
+    double r12 = p12_[k] + dt * p22_[k];
+    // F P F^T + Q
+    double n00 = r00 + dt * r01 + h * r02 + q00;
+    double n01 = r01 + dt * r02 + q01;
+    double n02 = r02 + q02;
+    double n11 = r11 + dt * r12 + q11;
+    double n12 = r12 + q12;
+    double n22 = p22_[k] + q22;
+
+    // Position measurement
+    double s = n00 + r;
+    double k0 = n00 / s;
+    double k1 = n01 / s;
+    double k2 = n02 / s;
+    double y = measurement_[k] - x;
+    x_[k] = x + k0 * y;
+    v_[k] = v + k1 * y;
+    a_[k] = a + k2 * y;
+    p00_[k] = n00 - k0 * n00;
+    p01_[k] = n01 - k0 * n01;
+    p02_[k] = n02 - k0 * n02;
+    p11_[k] = n11 - k1 * n01;
+    p12_[k] = n12 - k1 * n02;
+    p22_[k] = n22 - k2 * n02;
+
+    velocity_[k] = v_[k];
+    velocity_variance_[k] = p11_[k];
+  }
+}
+
+void TwistEstimator::update_savitzky_golay(size_t body, double t)
+{
+  size_t n = samples_[body] < window_ ? samples_[body] + 1 : window_;
+  // The newest sample is written at samples_ % window_, the others are before it
+  size_t head = samples_[body] % window_;
+  double * times = &history_time_[body * window_];
+  double * history = &history_[body * kChannels * window_];
+  times[head] = t;
+  for (size_t c = 0; c < kChannels; c++) {
+    history[c * window_ + head] = measurement_[body * kChannels + c];
+  }
+
+  size_t first = body * kChannels;
+  if (n < 2) {
+    for (size_t k = first; k < first + kChannels; k++) {
+      velocity_[k] = 0.0;
+      velocity_variance_[k] = kInitialVelocityVariance;
+    }
+    return;
+  }
+
+  // Least squares fit of y = b0 + b1 tau + b2 tau^2 with tau = time - t, so b1 is the velocity
+  // at t. The normal matrix only depends on the times, shared by the 6 channels.
+  double s[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+  for (size_t i = 0; i < n; i++) {
+    double tau = times[(head + window_ - i) % window_] - t;
+    double tau2 = tau * tau;
+    s[0] += 1.0;
+    s[1] += tau;
+    s[2] += tau2;
+    s[3] += tau2 * tau;
+    s[4] += tau2 * tau2;
+  }
+
+  // Velocity row of the inverse of the normal matrix (linear fit with 2 samples), times det
+  double w0, w1, w2, det;
+  if (n < 3) {
+    det = s[0] * s[2] - s[1] * s[1];
+    w0 = -s[1];
+    w1 = s[0];
+    w2 = 0.0;
+  } else {
+    det = s[0] * (s[2] * s[4] - s[3] * s[3]) - s[1] * (s[1] * s[4] - s[3] * s[2]) +
+      s[2] * (s[1] * s[3] - s[2] * s[2]);
+    w0 = -(s[1] * s[4] - s[2] * s[3]);
+    w1 = s[0] * s[4] - s[2] * s[2];
+    w2 = -(s[0] * s[3] - s[1] * s[2]);
+  }
+  if (det <= 0.0) {
+    return;
+  }
+
+  for (size_t c = 0; c < kChannels; c++) {
+    const double * channel = &history[c * window_];
+    double m0 = 0.0, m1 = 0.0, m2 = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      size_t slot = (head + window_ - i) % window_;
+      double tau = times[slot] - t;
+      m0 += channel[slot];
+      m1 += channel[slot] * tau;
+      m2 += channel[slot] * tau * tau;
+    }
+    velocity_[first + c] = (w0 * m0 + w1 * m1 + w2 * m2) / det;
+    velocity_variance_[first + c] = measurement_noise_ * w1 / det;
+  }
+}
@@ -14,9 +14,15 @@
 //
 // Author: David Vargas Frutos <david.vargas@urjc.es>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
 
 #include "vicon2_driver/vicon2_driver.hpp"
 #include "lifecycle_msgs/msg/state.hpp"
@@ -97,16 +103,131 @@ string Enum2String(const ViconDataStreamSDK::CPP::Result::Enum i_result)
   }
 }
 
+// Transform the Vicon SDK enumerations to strings
+string Enum2String(const ViconDataStreamSDK::CPP::DeviceType::Enum i_device_type)
+{
+  switch (i_device_type) {
+    case ViconDataStreamSDK::CPP::DeviceType::ForcePlate:
+      return "ForcePlate";
+    case ViconDataStreamSDK::CPP::DeviceType::EyeTracker:
+      return "EyeTracker";
+    default:
+      return "Unknown";
+  }
+}
+
+// Transform the Vicon SDK enumerations to strings
+string Enum2String(const ViconDataStreamSDK::CPP::Unit::Enum i_unit)
+{
+  switch (i_unit) {
+    case ViconDataStreamSDK::CPP::Unit::Volt:
+      return "Volt";
+    case ViconDataStreamSDK::CPP::Unit::Newton:
+      return "Newton";
+    case ViconDataStreamSDK::CPP::Unit::NewtonMeter:
+      return "NewtonMeter";
+    case ViconDataStreamSDK::CPP::Unit::Meter:
+      return "Meter";
+    case ViconDataStreamSDK::CPP::Unit::Kilogram:
+      return "Kilogram";
+    case ViconDataStreamSDK::CPP::Unit::Second:
+      return "Second";
+    case ViconDataStreamSDK::CPP::Unit::Ampere:
+      return "Ampere";
+    case ViconDataStreamSDK::CPP::Unit::Kelvin:
+      return "Kelvin";
+    case ViconDataStreamSDK::CPP::Unit::Mole:
+      return "Mole";
+    case ViconDataStreamSDK::CPP::Unit::Candela:
+      return "Candela";
+    case ViconDataStreamSDK::CPP::Unit::Radian:
+      return "Radian";
+    case ViconDataStreamSDK::CPP::Unit::Steradian:
+      return "Steradian";
+    case ViconDataStreamSDK::CPP::Unit::MeterSquared:
+      return "MeterSquared";
+    case ViconDataStreamSDK::CPP::Unit::MeterCubed:
+      return "MeterCubed";
+    case ViconDataStreamSDK::CPP::Unit::MeterPerSecond:
+      return "MeterPerSecond";
+    case ViconDataStreamSDK::CPP::Unit::MeterPerSecondSquared:
+      return "MeterPerSecondSquared";
+    case ViconDataStreamSDK::CPP::Unit::RadianPerSecond:
+      return "RadianPerSecond";
+    case ViconDataStreamSDK::CPP::Unit::RadianPerSecondSquared:
+      return "RadianPerSecondSquared";
+    case ViconDataStreamSDK::CPP::Unit::Hertz:
+      return "Hertz";
+    case ViconDataStreamSDK::CPP::Unit::Joule:
+      return "Joule";
+    case ViconDataStreamSDK::CPP::Unit::Watt:
+      return "Watt";
+    case ViconDataStreamSDK::CPP::Unit::Pascal:
+      return "Pascal";
+    case ViconDataStreamSDK::CPP::Unit::Lumen:
+      return "Lumen";
+    case ViconDataStreamSDK::CPP::Unit::Lux:
+      return "Lux";
+    case ViconDataStreamSDK::CPP::Unit::Coulomb:
+      return "Coulomb";
+    case ViconDataStreamSDK::CPP::Unit::Ohm:
+      return "Ohm";
+    case ViconDataStreamSDK::CPP::Unit::Farad:
+      return "Farad";
+    case ViconDataStreamSDK::CPP::Unit::Weber:
+      return "Weber";
+    case ViconDataStreamSDK::CPP::Unit::Tesla:
+      return "Tesla";
+    case ViconDataStreamSDK::CPP::Unit::Henry:
+      return "Henry";
+    case ViconDataStreamSDK::CPP::Unit::Siemens:
+      return "Siemens";
+    case ViconDataStreamSDK::CPP::Unit::Becquerel:
+      return "Becquerel";
+    case ViconDataStreamSDK::CPP::Unit::Gray:
+      return "Gray";
+    case ViconDataStreamSDK::CPP::Unit::Sievert:
+      return "Sievert";
+    case ViconDataStreamSDK::CPP::Unit::Katal:
+      return "Katal";
+    default:
+      return "Unknown";
+  }
+}
+
 // The vicon driver node has differents parameters to initialized with the vicon2_driver_params.yaml
-ViconDriverNode::ViconDriverNode(const rclcpp::NodeOptions node_options)
-: device_control::ControlledLifecycleNode(static_cast<string>("vicon2_driver_node"))
+ViconDriverNode::ViconDriverNode(const rclcpp::NodeOptions & node_options)
+: device_control::ControlledLifecycleNode(static_cast<string>("vicon2_driver_node"), node_options),
+  steady_clock_(RCL_STEADY_TIME),
+  blob_worker_(std::bind(&ViconDriverNode::pack_greyscale_blobs, this, std::placeholders::_1)),
+  video_worker_(std::bind(&ViconDriverNode::publish_video, this, std::placeholders::_1))
 {
   declare_parameter<std::string>("stream_mode", "ClientPull");
   declare_parameter<std::string>("host_name", "192.168.10.1:801");
+  declare_parameter<std::vector<std::string>>("host_names", std::vector<std::string>());
+  declare_parameter<double>("failover_timeout_periods", 20.0);
   declare_parameter<std::string>("tf_ref_frame_id", "vicon_world");
   declare_parameter<std::string>("tracked_frame_suffix", "vicon");
   declare_parameter<bool>("publish_markers", false);
+  declare_parameter<bool>("publish_marker_rays", false);
+  declare_parameter<bool>("labeled_markers_by_index", false);
+  declare_parameter<bool>("publish_marker_cloud", false);
   declare_parameter<bool>("publish_subjects", false);
+  declare_parameter<bool>("publish_frame_metadata", false);
+  declare_parameter<bool>("publish_force_plates", false);
+  declare_parameter<bool>("publish_devices", false);
+  declare_parameter<bool>("publish_segment_batch", false);
+  declare_parameter<bool>("publish_eye_trackers", false);
+  declare_parameter<std::vector<std::string>>("eye_tracker_segments", std::vector<std::string>());
+  declare_parameter<bool>("publish_camera_calibration", false);
+  declare_parameter<double>("camera_calibration_refresh_s", 10.0);
+  declare_parameter<bool>("publish_centroids", false);
+  declare_parameter<std::vector<int64_t>>("centroid_camera_ids", std::vector<int64_t>());
+  declare_parameter<bool>("publish_greyscale_blobs", false);
+  declare_parameter<std::vector<int64_t>>("greyscale_camera_ids", std::vector<int64_t>());
+  declare_parameter<bool>("publish_video", false);
+  declare_parameter<std::vector<int64_t>>("video_camera_ids", std::vector<int64_t>());
+  declare_parameter<int>("video_qos_depth", 1);
   declare_parameter<bool>("marker_data_enabled", false);
   declare_parameter<bool>("broadcast_tf", false);
   declare_parameter<bool>("unlabeled_marker_data_enabled", false);
@@ -115,9 +236,90 @@ ViconDriverNode::ViconDriverNode(const rclcpp::NodeOptions node_options)
   declare_parameter<int>("droppedFrameCount", 0);
   declare_parameter<int>("n_markers", 0);
   declare_parameter<int>("n_unlabeled_markers", 0);
+  declare_parameter<bool>("track_unlabeled_markers", false);
+  declare_parameter<double>("marker_track_gate_mm", 20.0);
+  declare_parameter<int>("marker_track_max_missed", 5);
+  declare_parameter<std::vector<std::string>>("marker_cluster_names", std::vector<std::string>());
+  declare_parameter<double>("max_cluster_residual_mm", 5.0);
   declare_parameter<std::string>("qos_history_policy", "keep_all");
   declare_parameter<std::string>("qos_reliability_policy", "best_effort");
   declare_parameter<int>("qos_depth", 10);
+  declare_parameter<int>("subject_worker_threads", 0);
+  declare_parameter<double>("min_object_quality", 0.0);
+  declare_parameter<double>("pose_variance", 0.0001);
+  declare_parameter<int>("max_extrapolation_ms", 0);
+  declare_parameter<std::string>("twist_estimator", "kalman");
+  declare_parameter<int>("twist_window", 7);
+  declare_parameter<double>("twist_process_noise", 50.0);
+  declare_parameter<bool>("pose_filter", false);
+  declare_parameter<double>("max_linear_velocity", 10.0);
+  declare_parameter<double>("max_angular_velocity", 30.0);
+  declare_parameter<int>("max_rejected_frames", 10);
+  declare_parameter<bool>("publish_predicted_poses", false);
+  declare_parameter<double>("prediction_offset_ms", 0.0);
+  declare_parameter<bool>("evaluate_prediction", false);
+  declare_parameter<int>("capture_thread_priority", 0);
+  declare_parameter<std::vector<int64_t>>("capture_thread_cpus", std::vector<int64_t>());
+  declare_parameter<bool>("lock_memory", false);
+  declare_parameter<int>("reserved_frame_items", 256);
+  declare_parameter<int>("connection_timeout_ms", 1000);
+  declare_parameter<int>("reconnect_backoff_initial_ms", 250);
+  declare_parameter<int>("reconnect_backoff_max_ms", 8000);
+  declare_parameter<std::string>("timestamp_mode", "latency");
+  declare_parameter<int>("clock_estimator_window", 500);
+  declare_parameter<double>("clock_outlier_threshold", 4.0);
+  declare_parameter<double>("clock_max_drift_ppm", 1000.0);
+  declare_parameter<std::vector<double>>(
+    "drop_rate_windows", std::vector<double>{1.0, 10.0, 60.0});
+  declare_parameter<double>("drop_budget_pct", 1.0);
+  declare_parameter<int>("drop_alert_period_ms", 5000);
+
+  capture_running_ = false;
+  connected_ = false;
+  reconnecting_ = false;
+  connection_attempts_ = 0;
+  reconnect_count_ = 0;
+  last_reconnect_time_ = 0.0;
+  max_reconnect_time_ = 0.0;
+  active_server_ = 0;
+  frame_rate_ = 0.0;
+  failing_over_ = false;
+  failover_count_ = 0;
+  last_failover_time_ = 0.0;
+  max_failover_time_ = 0.0;
+  device_count_ = 0;
+  device_schema_id_ = 0;
+  device_schema_valid_ = false;
+  device_values_size_ = 0;
+  camera_calibration_valid_ = false;
+  camera_count_ = 0;
+  camera_list_valid_ = false;
+  camera_filter_pending_ = false;
+  centroid_count_ = 0;
+  low_quality_count_ = 0;
+  labeled_marker_resolutions_ = 0;
+  unbound_labeled_markers_ = 0;
+  unlabeled_track_count_ = 0;
+  unlabeled_tracks_started_ = 0;
+  solved_cluster_count_ = 0;
+  unsolved_cluster_count_ = 0;
+  occluded_segments_ = 0;
+  longest_occlusion_ = 0.0;
+  predicted_pose_count_ = 0;
+  occlusion_count_ = 0;
+  bridged_occlusion_count_ = 0;
+  flipped_pose_count_ = 0;
+  rejected_pose_count_ = 0;
+  prediction_horizon_ = 0.0;
+  evaluated_prediction_count_ = 0;
+  realtime_priority_set_ = false;
+  cpu_affinity_set_ = false;
+  memory_locked_ = false;
+}
+
+ViconDriverNode::~ViconDriverNode()
+{
+  stop_capture_thread();
 }
 
 // In charge of choose the different driver options related and provided by the Vicon SDK
@@ -155,6 +357,62 @@ void ViconDriverNode::set_settings_vicon()
     get_logger(), "IsSegmentDataEnabled? %s",
     client.IsSegmentDataEnabled().Enabled ? "true" : "false");
 
+  if (publish_markers_ || publish_marker_cloud_ || !marker_clusters_.empty()) {
+    client.EnableMarkerData();
+    marker_data_enabled_ = client.IsMarkerDataEnabled().Enabled;
+    RCLCPP_INFO(
+      get_logger(), "IsMarkerDataEnabled? %s", marker_data_enabled_ ? "true" : "false");
+
+    client.EnableUnlabeledMarkerData();
+    unlabeled_marker_data_enabled_ = client.IsUnlabeledMarkerDataEnabled().Enabled;
+    RCLCPP_INFO(
+      get_logger(), "IsUnlabeledMarkerDataEnabled? %s",
+      unlabeled_marker_data_enabled_ ? "true" : "false");
+
+    if (publish_marker_rays_) {
+      client.EnableMarkerRayData();
+      RCLCPP_INFO(
+        get_logger(), "IsMarkerRayDataEnabled? %s",
+        client.IsMarkerRayDataEnabled().Enabled ? "true" : "false");
+    }
+  }
+
+  if (publish_force_plates_ || publish_devices_ || publish_eye_trackers_) {
+    client.EnableDeviceData();
+    RCLCPP_INFO(
+      get_logger(), "IsDeviceDataEnabled? %s",
+      client.IsDeviceDataEnabled().Enabled ? "true" : "false");
+  }
+
+  if (publish_camera_calibration_) {
+    client.EnableCameraCalibrationData();
+    RCLCPP_INFO(
+      get_logger(), "IsCameraCalibrationDataEnabled? %s",
+      client.IsCameraCalibrationDataEnabled().Enabled ? "true" : "false");
+  }
+
+  if (publish_centroids_) {
+    client.EnableCentroidData();
+    RCLCPP_INFO(
+      get_logger(), "IsCentroidDataEnabled? %s",
+      client.IsCentroidDataEnabled().Enabled ? "true" : "false");
+  }
+
+  if (publish_greyscale_blobs_) {
+    client.EnableGreyscaleData();
+    RCLCPP_INFO(
+      get_logger(), "IsGreyscaleDataEnabled? %s",
+      client.IsGreyscaleDataEnabled().Enabled ? "true" : "false");
+  }
+
+  if (publish_video_) {
+    client.EnableVideoData();
+    RCLCPP_INFO(
+      get_logger(), "IsVideoDataEnabled? %s",
+      client.IsVideoDataEnabled().Enabled ? "true" : "false");
+  }
+  camera_filter_pending_ = true;
+
   ViconDataStreamSDK::CPP::Output_GetVersion _Output_GetVersion = client.GetVersion();
 
   RCLCPP_INFO(
@@ -174,20 +432,377 @@ void ViconDriverNode::set_settings_vicon()
 }
 
 // Start the vicon_driver_node if the Vicon system is OK.
-void ViconDriverNode::start_vicon()
+// Returns when the capture is stopped or when the connection with the server is lost.
+bool ViconDriverNode::start_vicon()
 {
   set_settings_vicon();
   // rclcpp::WallRate d(1.0 / 240.0);
   auto period = std::chrono::milliseconds(100);
+  // Poll at the frame rate when frames are missing, so a silent server is detected in time
+  if (frame_rate_ > 0.0) {
+    period = std::min(
+      period, std::chrono::milliseconds(static_cast<int>(std::ceil(1000.0 / frame_rate_))));
+  }
   rclcpp::Rate d(period);
-  while (rclcpp::ok()) {
-    while (client.GetFrame().Result != ViconDataStreamSDK::CPP::Result::Success && rclcpp::ok()) {
-      RCLCPP_WARN(get_logger(), "getFrame returned false");
+  last_frame_time_ = std::chrono::steady_clock::now();
+  // The devices and cameras of the server are read again with the first frame
+  device_schema_valid_ = false;
+  camera_calibration_valid_ = false;
+  camera_list_valid_ = false;
+  labeled_marker_index_.reset();
+  marker_tracker_.reset();
+  for (MarkerCluster & cluster : marker_clusters_) {
+    cluster.reset();
+  }
+  segment_tracks_.clear();
+  twist_estimator_.clear();
+  pose_jump_filter_.clear();
+  {
+    // The server may have changed, so the frame -> host clock fit starts again.
+    // Frames lost while disconnected are not counted as dropped either.
+    boost::mutex::scoped_lock lock(capture_stats_mutex_);
+    clock_estimator_.reset();
+    servers_[active_server_].frame_gaps.break_continuity();
+  }
+  while (rclcpp::ok() && capture_running_) {
+    ViconDataStreamSDK::CPP::Result::Enum result = client.GetFrame().Result;
+    while (result != ViconDataStreamSDK::CPP::Result::Success &&
+      rclcpp::ok() && capture_running_)
+    {
+      if (result == ViconDataStreamSDK::CPP::Result::NotConnected) {
+        RCLCPP_WARN(get_logger(), "Connection with the Vicon DataStream server lost");
+        return false;
+      }
+      if (servers_.size() > 1 && frame_rate_ > 0.0) {
+        double silence = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - last_frame_time_).count();
+        if (silence > failover_timeout_periods_ / frame_rate_) {
+          RCLCPP_WARN(
+            get_logger(), "No frames from %s for %.3f s",
+            servers_[active_server_].host_name.c_str(), silence);
+          return false;
+        }
+      }
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), steady_clock_, 1000, "getFrame returned %s", Enum2String(result).c_str());
       d.sleep();
+      result = client.GetFrame().Result;
+    }
+    if (!capture_running_) {
+      break;
+    }
+    frame_wakeup_time_ = std::chrono::steady_clock::now();
+    last_frame_time_ = frame_wakeup_time_;
+    if (failing_over_) {
+      failing_over_ = false;
+      double failover_time = std::chrono::duration<double>(
+        frame_wakeup_time_ - failover_start_time_).count();
+      RCLCPP_INFO(
+        get_logger(), "Failed over to %s in %.3f s",
+        servers_[active_server_].host_name.c_str(), failover_time);
+      boost::mutex::scoped_lock lock(capture_stats_mutex_);
+      failover_count_++;
+      last_failover_time_ = failover_time;
+      max_failover_time_ = std::max(max_failover_time_, failover_time);
+    }
+    if (reconnecting_) {
+      reconnecting_ = false;
+      double reconnect_time = std::chrono::duration<double>(
+        frame_wakeup_time_ - disconnection_time_).count();
+      RCLCPP_INFO(get_logger(), "Receiving frames again after %.3f s", reconnect_time);
+      boost::mutex::scoped_lock lock(capture_stats_mutex_);
+      last_reconnect_time_ = reconnect_time;
+      max_reconnect_time_ = std::max(max_reconnect_time_, reconnect_time);
     }
     now_time = this->now();
     process_frame();
   }
+  return true;
+}
+
+// Body of the capture thread: applies the real-time settings and keeps the client connected,
+// retrying with an exponential backoff until the capture is stopped.
+// With several servers configured, they are tried in order and the driver moves to the
+// next one when the active server drops the connection or stops sending frames.
+void ViconDriverNode::capture_thread_main()
+{
+  configure_capture_thread();
+  // The capture thread waits for the subject workers every frame, so they run with its
+  // scheduling and CPUs; at a lower priority they would delay it as much as any other thread
+  subject_pool_.start(
+    max(subject_worker_threads_, 0), [this]() {return configure_worker_thread();});
+
+  int backoff_ms = reconnect_backoff_initial_ms_;
+  size_t failed_attempts = 0;
+  while (rclcpp::ok() && capture_running_) {
+    if (!connect_vicon()) {
+      // The next server is tried right away, the backoff only applies once all of them failed
+      failed_attempts++;
+      select_server((active_server_ + 1) % servers_.size());
+      if (failed_attempts % servers_.size() == 0) {
+        RCLCPP_INFO(get_logger(), "Retrying in %d ms", backoff_ms);
+        wait_capture(std::chrono::milliseconds(backoff_ms));
+        backoff_ms = std::min(2 * backoff_ms, reconnect_backoff_max_ms_);
+      }
+      continue;
+    }
+    failed_attempts = 0;
+    backoff_ms = reconnect_backoff_initial_ms_;
+
+    if (!start_vicon()) {
+      // The server dropped the connection, the time until frames arrive again is measured
+      connected_ = false;
+      reconnecting_ = true;
+      disconnection_time_ = std::chrono::steady_clock::now();
+      client.Disconnect();
+
+      if (servers_.size() > 1) {
+        if (!failing_over_) {
+          failing_over_ = true;
+          failover_start_time_ = last_frame_time_;
+        }
+        select_server((active_server_ + 1) % servers_.size());
+      }
+    }
+  }
+}
+
+// Makes another server the active one. Frame numbers are only comparable within a server,
+// so every server keeps its own frame gap tracker.
+void ViconDriverNode::select_server(size_t index)
+{
+  if (index == active_server_) {
+    return;
+  }
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  active_server_ = index;
+  const FrameGapTracker & frame_gaps = servers_[active_server_].frame_gaps;
+  lastFrameNumber_ = static_cast<int>(frame_gaps.last_frame_number());
+  frameCount_ = static_cast<int>(frame_gaps.expected());
+  droppedFrameCount_ = static_cast<int>(frame_gaps.dropped());
+}
+
+// Sleeps for the given time, waking up early if the capture is stopped
+void ViconDriverNode::wait_capture(std::chrono::milliseconds time)
+{
+  auto deadline = std::chrono::steady_clock::now() + time;
+  while (capture_running_ && std::chrono::steady_clock::now() < deadline) {
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+  }
+}
+
+// Real-time scheduling and CPU pinning only affect the calling (capture) thread.
+void ViconDriverNode::configure_capture_thread()
+{
+  std::string error;
+  if (capture_thread_priority_ > 0) {
+    realtime_priority_set_ = set_thread_realtime_priority(capture_thread_priority_, error);
+    if (realtime_priority_set_) {
+      RCLCPP_INFO(
+        get_logger(), "Capture thread running with SCHED_FIFO priority %d",
+        capture_thread_priority_);
+    } else {
+      RCLCPP_WARN(
+        get_logger(), "Unable to set SCHED_FIFO priority %d for the capture thread: %s",
+        capture_thread_priority_, error.c_str());
+    }
+  }
+  if (!capture_thread_cpus_.empty()) {
+    cpu_affinity_set_ = set_thread_cpu_affinity(capture_thread_cpus_, error);
+    if (cpu_affinity_set_) {
+      RCLCPP_INFO(
+        get_logger(), "Capture thread pinned to CPUs %s",
+        cpu_list_to_string(capture_thread_cpus_).c_str());
+    } else {
+      RCLCPP_WARN(
+        get_logger(), "Unable to pin the capture thread to CPUs %s: %s",
+        cpu_list_to_string(capture_thread_cpus_).c_str(), error.c_str());
+    }
+  }
+  if (lock_memory_) {
+    prefault_stack();
+  }
+}
+
+// Reserves the buffers reused every frame. With the memory locked for the future they are
+// faulted in here, on activation, instead of page faulting as they grow in the first frames.
+void ViconDriverNode::reserve_frame_buffers()
+{
+  size_t n_items = static_cast<size_t>(max(reserved_frame_items_, 0));
+  segment_samples_.reserve(n_items);
+  unlabeled_positions_.reserve(3 * n_items);
+  unlabeled_ids_.reserve(n_items);
+  cloud_markers_.reserve(n_items);
+}
+
+// The real-time settings of the capture thread for a subject worker, false if any failed
+bool ViconDriverNode::configure_worker_thread()
+{
+  std::string error;
+  bool configured = true;
+  if (capture_thread_priority_ > 0 &&
+    !set_thread_realtime_priority(capture_thread_priority_, error))
+  {
+    configured = false;
+  }
+  if (!capture_thread_cpus_.empty() && !set_thread_cpu_affinity(capture_thread_cpus_, error)) {
+    configured = false;
+  }
+  if (lock_memory_) {
+    prefault_stack();
+  }
+  return configured;
+}
+
+void ViconDriverNode::stop_capture_thread()
+{
+  capture_running_ = false;
+  if (capture_thread_.joinable()) {
+    capture_thread_.join();
+  }
+  blob_worker_.stop();
+  video_worker_.stop();
+  subject_pool_.stop();
+}
+
+void ViconDriverNode::diagnose_capture(diagnostic_updater::DiagnosticStatusWrapper & stat)
+{
+  bool rt_failed = (capture_thread_priority_ > 0 && !realtime_priority_set_) ||
+    (!capture_thread_cpus_.empty() && !cpu_affinity_set_) ||
+    (lock_memory_ && !memory_locked_) ||
+    subject_pool_.initialized() < subject_pool_.size();
+
+  if (!capture_running_) {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Capture thread not running");
+  } else if (rt_failed) {
+    stat.summary(
+      diagnostic_msgs::msg::DiagnosticStatus::WARN,
+      "Capture thread running without the requested real-time settings");
+  } else {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Capture thread running");
+  }
+
+  stat.add("SCHED_FIFO priority", realtime_priority_set_ ? capture_thread_priority_ : 0);
+  stat.add("CPUs", cpu_affinity_set_ ? cpu_list_to_string(capture_thread_cpus_) : "any");
+  stat.add("Memory locked", memory_locked_.load());
+  stat.add("Subject worker threads", subject_pool_.size());
+  stat.add("Subject worker threads with the real-time settings", subject_pool_.initialized());
+
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  stat.add("Wake-up samples", wakeup_jitter_.count());
+  stat.addf("Wake-up jitter mean (us)", "%.1f", wakeup_jitter_.mean() * 1e6);
+  stat.addf("Wake-up jitter stddev (us)", "%.1f", wakeup_jitter_.stddev() * 1e6);
+  stat.addf("Wake-up jitter max (us)", "%.1f", wakeup_jitter_.max_abs() * 1e6);
+  stat.add("Poses below min quality", low_quality_count_);
+  if (labeled_markers_by_index_ || publish_marker_cloud_) {
+    stat.add("Labeled marker index resolutions", labeled_marker_resolutions_);
+    stat.add("Labeled markers not bound", unbound_labeled_markers_);
+  }
+  if (track_unlabeled_markers_) {
+    stat.add("Unlabeled marker tracks", unlabeled_track_count_);
+    stat.add("Unlabeled marker tracks started", unlabeled_tracks_started_);
+  }
+  if (!marker_clusters_.empty()) {
+    stat.addf(
+      "Marker clusters solved", "%u/%zu", solved_cluster_count_, marker_clusters_.size());
+    stat.add("Marker cluster frames not solved", unsolved_cluster_count_);
+  }
+  if (pose_filter_) {
+    stat.add("Quaternion sign flips", flipped_pose_count_);
+    stat.add("Pose jumps rejected", rejected_pose_count_);
+  }
+  wakeup_jitter_.reset();
+  if (publish_greyscale_blobs_) {
+    stat.add("Blob frames published", blob_worker_.processed());
+    stat.add("Blob frames dropped", blob_worker_.dropped());
+  }
+  if (publish_video_) {
+    stat.add("Video frames published", video_worker_.processed());
+    stat.add("Video frames dropped", video_worker_.dropped());
+  }
+}
+
+// Updates the frame continuity of the active server with a new frame number and warns when the
+// drop rate of any full window is above the budget
+FrameGapTracker::Result ViconDriverNode::update_frame_gaps(uint32_t frame_number)
+{
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  ViconServer & server = servers_[active_server_];
+  FrameGapTracker & frame_gaps = server.frame_gaps;
+
+  // The windows are given in seconds, they are sized in frames once the frame rate is known
+  if (frame_rate_ > 0.0 && frame_rate_ != server.window_rate) {
+    std::vector<size_t> window_sizes;
+    for (double window : drop_rate_windows_) {
+      window_sizes.push_back(static_cast<size_t>(std::max(1.0, std::round(window * frame_rate_))));
+    }
+    frame_gaps.set_window_sizes(window_sizes);
+    server.window_rate = frame_rate_;
+  }
+
+  FrameGapTracker::Result result = frame_gaps.update(frame_number);
+  lastFrameNumber_ = static_cast<int>(frame_gaps.last_frame_number());
+  frameCount_ = static_cast<int>(frame_gaps.expected());
+  droppedFrameCount_ = static_cast<int>(frame_gaps.dropped());
+
+  if (result == FrameGapTracker::GAP) {
+    RCLCPP_DEBUG(
+      get_logger(),
+      "%u more (total %d / %d, %f %%) frame(s) dropped. Consider adjusting rates",
+      frame_gaps.last_dropped(), droppedFrameCount_, frameCount_, frame_gaps.drop_pct());
+  } else if (result == FrameGapTracker::RESET) {
+    RCLCPP_WARN(
+      get_logger(), "Frame number jumped to %u, frame continuity restarted", frame_number);
+  }
+
+  for (size_t i = 0; i < frame_gaps.window_count(); i++) {
+    if (frame_gaps.window_full(i) && frame_gaps.window_drop_pct(i) > drop_budget_pct_) {
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), steady_clock_, drop_alert_period_ms_,
+        "%.2f %% of the frames dropped in the last %.1f s, above the %.2f %% budget",
+        frame_gaps.window_drop_pct(i), drop_rate_windows_[i], drop_budget_pct_);
+      break;
+    }
+  }
+  return result;
+}
+
+void ViconDriverNode::diagnose_frame_drops(diagnostic_updater::DiagnosticStatusWrapper & stat)
+{
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  const FrameGapTracker & frame_gaps = servers_[active_server_].frame_gaps;
+
+  bool over_budget = false;
+  for (size_t i = 0; i < frame_gaps.window_count(); i++) {
+    over_budget |= frame_gaps.window_full(i) && frame_gaps.window_drop_pct(i) > drop_budget_pct_;
+  }
+  if (over_budget) {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::WARN, "Frame drops above the budget");
+  } else {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Frame drops within the budget");
+  }
+
+  stat.add("Host", servers_[active_server_].host_name);
+  stat.add("Received frames", frame_gaps.received());
+  stat.add("Expected frames", frame_gaps.expected());
+  stat.add("Dropped frames", frame_gaps.dropped());
+  stat.addf("Dropped (%)", "%.3f", frame_gaps.drop_pct());
+  stat.addf("Drop budget (%)", "%.3f", drop_budget_pct_);
+  for (size_t i = 0; i < frame_gaps.window_count(); i++) {
+    stringstream key;
+    key << "Dropped in the last " << drop_rate_windows_[i] << " s (%)";
+    stat.addf(
+      key.str(), "%.3f%s", frame_gaps.window_drop_pct(i),
+      frame_gaps.window_full(i) ? "" : " (window filling)");
+  }
+  stat.add("Gaps", frame_gaps.gaps());
+  stat.add("Frame number resets", frame_gaps.resets());
+  stat.add("Duplicated frames", frame_gaps.duplicates());
+  for (size_t bin = 0; bin < FrameGapTracker::kHistogramBins; bin++) {
+    stat.add(
+      "Gaps of " + FrameGapTracker::histogram_label(bin) + " frames",
+      frame_gaps.gap_histogram()[bin]);
+  }
 }
 
 // Stop the vicon_driver_node if the lifecycle node state is shutdown.
@@ -195,6 +810,8 @@ bool ViconDriverNode::stop_vicon()
 {
   RCLCPP_INFO(get_logger(), "Disconnecting from Vicon DataStream SDK");
   client.Disconnect();
+  connected_ = false;
+  reconnecting_ = false;
   RCLCPP_INFO(get_logger(), "... disconnected");
   return true;
 }
@@ -217,34 +834,194 @@ void ViconDriverNode::process_frame()
   ViconDataStreamSDK::CPP::Output_GetFrameRate OutputFrameRate = client.GetFrameRate();
   // RCLCPP_WARN(get_logger(), "Frame rate: %f", OutputFrameRate.FrameRateHz);
 
-  int frameDiff = 0;
-  if (lastFrameNumber_ != 0) {
-    frameDiff = OutputFrameNum.FrameNumber - lastFrameNumber_;
-    frameCount_ += frameDiff;
-    if ((frameDiff) > 1) {
-      droppedFrameCount_ += frameDiff;
-      double droppedFramePct = static_cast<double>(droppedFrameCount_ / frameCount_ * 100);
+  if (OutputFrameRate.Result == ViconDataStreamSDK::CPP::Result::Success) {
+    frame_rate_ = OutputFrameRate.FrameRateHz;
+  }
 
-      RCLCPP_DEBUG(
-        get_logger(),
-        "%d more (total %d / %d, %f %%) frame(s) dropped. Consider adjusting rates",
-        frameDiff, droppedFrameCount_, frameCount_, droppedFramePct);
-    }
+  FrameGapTracker::Result gap_result = update_frame_gaps(OutputFrameNum.FrameNumber);
+  // The wake-up jitter is the deviation of the time between two frames from the frame period
+  if ((gap_result == FrameGapTracker::NEXT || gap_result == FrameGapTracker::GAP) &&
+    OutputFrameRate.FrameRateHz > 0.0)
+  {
+    uint32_t frames = servers_[active_server_].frame_gaps.last_dropped() + 1;
+    double expected = frames / OutputFrameRate.FrameRateHz;
+    double elapsed = std::chrono::duration<double>(
+      frame_wakeup_time_ - last_wakeup_time_).count();
+    boost::mutex::scoped_lock lock(capture_stats_mutex_);
+    wakeup_jitter_.add(elapsed - expected);
+  }
+  last_wakeup_time_ = frame_wakeup_time_;
+
+  if (camera_filter_pending_) {
+    set_camera_filter();
   }
-  lastFrameNumber_ = OutputFrameNum.FrameNumber;
 
-  if (frameDiff != 0) {
-    rclcpp::Duration vicon_latency(std::chrono::duration<double>(client.GetLatencyTotal().Total));
-    if (publish_markers_) {
-      process_markers(now_time - vicon_latency, lastFrameNumber_);
+  if (gap_result != FrameGapTracker::DUPLICATE) {
+    ViconDataStreamSDK::CPP::Output_GetLatencyTotal OutputLatency = client.GetLatencyTotal();
+    rclcpp::Duration vicon_latency(std::chrono::duration<double>(OutputLatency.Total));
+    ViconDataStreamSDK::CPP::Output_GetHardwareFrameNumber OutputHardwareFrameNum =
+      client.GetHardwareFrameNumber();
+    bool stamp_from_hardware_frame = false;
+    rclcpp::Time frame_time = stamp_frame(
+      now_time - vicon_latency, OutputHardwareFrameNum, stamp_from_hardware_frame);
+    // Time of the frame on the Vicon clock, free of the host jitter, for the per-segment
+    // estimators
+    double frame_clock = frame_time.seconds();
+    if (frame_rate_ > 0.0) {
+      frame_clock = OutputHardwareFrameNum.Result == ViconDataStreamSDK::CPP::Result::Success ?
+        OutputHardwareFrameNum.HardwareFrameNumber / frame_rate_ :
+        OutputFrameNum.FrameNumber / frame_rate_;
+    }
+    // The poses are predicted up to now, and beyond by prediction_offset_ms
+    prediction_horizon_ = OutputLatency.Total + prediction_offset_ms_ / 1000.0;
+
+    if (publish_frame_metadata_) {
+      auto metadata_msg = std::make_unique<vicon2_msgs::msg::FrameMetadata>();
+      metadata_msg->header.stamp = frame_time;
+      metadata_msg->header.frame_id = tf_ref_frame_id_;
+      metadata_msg->stamp_source = stamp_from_hardware_frame ?
+        vicon2_msgs::msg::FrameMetadata::STAMP_HARDWARE_FRAME :
+        vicon2_msgs::msg::FrameMetadata::STAMP_LATENCY;
+      metadata_msg->frame_number = OutputFrameNum.FrameNumber;
+      metadata_msg->hardware_frame_number = OutputHardwareFrameNum.HardwareFrameNumber;
+      metadata_msg->frame_rate = OutputFrameRate.FrameRateHz;
+      metadata_msg->latency = OutputLatency.Total;
+      fill_timecode(*metadata_msg);
+      metadata_pub_->publish(std::move(metadata_msg));
+    }
+
+    // The marker clusters are solved from the markers
+    if (publish_markers_ || !marker_clusters_.empty()) {
+      process_markers(frame_time, frame_clock, lastFrameNumber_);
+    }
+
+    if (publish_marker_cloud_) {
+      process_marker_cloud(frame_time);
+    }
+
+    std::unique_ptr<vicon2_msgs::msg::SegmentBatch> batch_msg;
+    if (publish_segment_batch_ || publish_eye_trackers_) {
+      batch_msg = std::make_unique<vicon2_msgs::msg::SegmentBatch>();
+      batch_msg->header.stamp = frame_time;
+      batch_msg->header.frame_id = tf_ref_frame_id_;
+      batch_msg->frame_number = OutputFrameNum.FrameNumber;
     }
 
     if (publish_subjects_) {
-      process_subjects(now_time - vicon_latency);
+      process_subjects(frame_time, frame_clock, batch_msg.get());
+    }
+
+    if (publish_eye_trackers_) {
+      process_eye_trackers(*batch_msg);
+    }
+
+    if (batch_msg) {
+      segment_batch_pub_->publish(std::move(batch_msg));
+    }
+
+    if (publish_camera_calibration_) {
+      process_camera_calibration(frame_time);
+    }
+
+    if (publish_centroids_) {
+      process_centroids(frame_time, OutputFrameNum.FrameNumber);
+    }
+
+    if (publish_greyscale_blobs_) {
+      process_greyscale_blobs(frame_time, OutputFrameNum.FrameNumber);
+    }
+
+    if (publish_video_) {
+      process_video(frame_time);
+    }
+
+    if (publish_force_plates_) {
+      process_force_plates(frame_time, OutputFrameNum.FrameNumber);
+    }
+
+    if (publish_devices_) {
+      process_devices(frame_time, OutputFrameNum.FrameNumber);
     }
     lastTime = now_time;
   }
 }
+// In "hardware_frame" mode the frames are stamped from their hardware frame number through the
+// fitted frame -> host clock line, which gives evenly spaced stamps free of the host wake-up
+// jitter. The latency compensated reception time is used until the fit is ready.
+rclcpp::Time ViconDriverNode::stamp_frame(
+  const rclcpp::Time & latency_stamp,
+  const ViconDataStreamSDK::CPP::Output_GetHardwareFrameNumber & OutputHardwareFrameNum,
+  bool & from_hardware_frame)
+{
+  from_hardware_frame = false;
+  if (timestamp_mode_ != "hardware_frame") {
+    return latency_stamp;
+  }
+
+  if (OutputHardwareFrameNum.Result != ViconDataStreamSDK::CPP::Result::Success) {
+    return latency_stamp;
+  }
+
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  clock_estimator_.set_nominal_rate(frame_rate_);
+  clock_estimator_.add_sample(
+    OutputHardwareFrameNum.HardwareFrameNumber, latency_stamp.nanoseconds());
+  if (!clock_estimator_.is_valid()) {
+    return latency_stamp;
+  }
+  from_hardware_frame = true;
+  return rclcpp::Time(
+    clock_estimator_.stamp(OutputHardwareFrameNum.HardwareFrameNumber),
+    latency_stamp.get_clock_type());
+}
+
+// Copies the SMPTE timecode of the current frame into the metadata message
+void ViconDriverNode::fill_timecode(vicon2_msgs::msg::FrameMetadata & metadata_msg)
+{
+  ViconDataStreamSDK::CPP::Output_GetTimecode OutputTimecode = client.GetTimecode();
+  metadata_msg.timecode_valid =
+    OutputTimecode.Result == ViconDataStreamSDK::CPP::Result::Success &&
+    OutputTimecode.Standard != ViconDataStreamSDK::CPP::TimecodeStandard::None;
+  if (OutputTimecode.Result != ViconDataStreamSDK::CPP::Result::Success) {
+    return;
+  }
+  // The SDK enumeration and the message constants share the same order
+  metadata_msg.timecode_standard = static_cast<uint8_t>(OutputTimecode.Standard);
+  metadata_msg.timecode_hours = OutputTimecode.Hours;
+  metadata_msg.timecode_minutes = OutputTimecode.Minutes;
+  metadata_msg.timecode_seconds = OutputTimecode.Seconds;
+  metadata_msg.timecode_frames = OutputTimecode.Frames;
+  metadata_msg.timecode_subframe = OutputTimecode.SubFrame;
+  metadata_msg.timecode_subframes_per_frame = OutputTimecode.SubFramesPerFrame;
+  metadata_msg.timecode_field_flag = OutputTimecode.FieldFlag;
+  metadata_msg.timecode_user_bits = OutputTimecode.UserBits;
+}
+
+void ViconDriverNode::diagnose_timestamping(diagnostic_updater::DiagnosticStatusWrapper & stat)
+{
+  if (timestamp_mode_ != "hardware_frame") {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Stamping with latency total");
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  if (clock_estimator_.is_valid()) {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Stamping from hardware frames");
+  } else {
+    stat.summary(
+      diagnostic_msgs::msg::DiagnosticStatus::WARN,
+      "Hardware frame clock fit not ready, stamping with latency total");
+  }
+  stat.add("Samples", clock_estimator_.sample_count());
+  stat.addf("Period (s)", "%.9f", clock_estimator_.period());
+  stat.addf("Drift (ppm)", "%.1f", clock_estimator_.drift_ppm());
+  stat.addf("Residual rms (us)", "%.1f", clock_estimator_.rms_residual() * 1e6);
+  stat.addf("Residual max (us)", "%.1f", clock_estimator_.max_residual() * 1e6);
+  stat.addf("Last residual (us)", "%.1f", clock_estimator_.last_residual() * 1e6);
+  stat.add("Rejected outliers", clock_estimator_.rejected_count());
+  stat.add("Fit restarts", clock_estimator_.reset_count());
+}
+
 //
 void ViconDriverNode::createSegmentThread(const std::string subject_name, const std::string segment_name)
 {
@@ -300,171 +1077,922 @@ void ViconDriverNode::createSegment(const std::string subject_name, const std::s
 }
 
 //
-void ViconDriverNode::process_subjects(const rclcpp::Time & frame_time)
+// The segments are read from the client here, in the capture thread, and published by the
+// subject workers (or here when subject_worker_threads is 0). The TFs and the batch are sent
+// once all of them are done. When batch_msg is given, the pose of every segment is also
+// added to it.
+// With pose_filter the quaternions are kept in the hemisphere of the previous ones and poses
+// that jump faster than the velocity limits are dropped.
+// Segments not seen (occluded, below min_object_quality or dropped) for up to
+// max_extrapolation_ms are published with the pose extrapolated at the velocities of their last
+// two poses. The twist of all the segments is estimated at once, at frame_clock (s).
+void ViconDriverNode::process_subjects(
+  const rclcpp::Time & frame_time, double frame_clock,
+  vicon2_msgs::msg::SegmentBatch * batch_msg)
 {
-  std::string tracked_frame, subject_name, segment_name;
   unsigned int n_subjects = client.GetSubjectCount().SubjectCount;
-  SegmentMap::iterator pub_it;
-  tf2::Transform transform;
-  std::vector<geometry_msgs::msg::TransformStamped, std::allocator<geometry_msgs::msg::TransformStamped> > transforms;
-  static unsigned int cnt = 0;
+  std::vector<std::pair<std::string, std::string>> new_segments;
+  size_t n_samples = 0;
+  unsigned int n_low_quality = 0;
+  unsigned int n_flipped = 0;
+  unsigned int n_rejected = 0;
+  double t = frame_clock;
+  unsigned int n_occluded = 0;
+  unsigned int n_predicted = 0;
+  unsigned int n_unpublished = 0;
+  double longest_occlusion = 0.0;
+  std::string unpublished_subject;
+  std::vector<std::pair<double, bool>> ended_occlusions;
 
-  for (unsigned int i_subjects = 0; i_subjects < n_subjects; i_subjects++)
   {
+    boost::mutex::scoped_try_lock lock(segments_mutex_);
+    // Adds the sample of a segment at translation (mm) and rotation (x, y, z, w)
+    auto add_sample = [&](
+      const std::string & subject_name, const std::string & segment_name,
+      const double translation[3], const double rotation[4], bool occluded, double quality,
+      double residual) {
+      // The samples are reused between frames, so their strings keep their storage
+      if (n_samples == segment_samples_.size()) {
+        segment_samples_.emplace_back();
+      }
+      SegmentSample & sample = segment_samples_[n_samples++];
+      sample.subject_name = subject_name;
+      sample.segment_name = segment_name;
+      sample.occluded = occluded;
+      sample.predicted = false;
+      sample.variance_scale = 1.0;
+      sample.quality = quality;
+      sample.residual = residual;
+      sample.low_quality = !sample.occluded && quality >= 0.0 && quality < min_object_quality_;
+      sample.publisher = nullptr;
+      sample.has_tf = false;
+      sample.has_twist = false;
+      sample.has_prediction = false;
+      sample.rejected = false;
+      if (sample.low_quality) {
+        n_low_quality++;
+      }
 
-    subject_name = client.GetSubjectName(i_subjects).SubjectName;
-    unsigned int n_segments = client.GetSegmentCount(subject_name).SegmentCount;
-
-    for (unsigned int i_segments = 0; i_segments < n_segments; i_segments++)
-    {
-      segment_name = client.GetSegmentName(subject_name, i_segments).SegmentName;
+      std::string segment_key = subject_name + "/" + segment_name;
+      SegmentTrackMap::iterator track_it = segment_tracks_.find(segment_key);
+      if (track_it == segment_tracks_.end()) {
+        track_it = segment_tracks_.emplace(segment_key, SegmentTrack()).first;
+        track_it->second.twist_body = twist_estimator_.add_body();
+        track_it->second.jump_filter_body = pose_jump_filter_.add_body();
+      }
+      SegmentTrack & track = track_it->second;
+      sample.twist_body = track.twist_body;
+      sample.track = &track;
+
+      const double position[3] = {
+        translation[0] / 1000, translation[1] / 1000, translation[2] / 1000};
+      double orientation[4] = {rotation[0], rotation[1], rotation[2], rotation[3]};
+      if (pose_filter_ && sample.seen()) {
+        PoseJumpFilter::Result result =
+          pose_jump_filter_.filter(track.jump_filter_body, t, position, orientation);
+        if (result == PoseJumpFilter::FLIPPED) {
+          n_flipped++;
+        } else if (result == PoseJumpFilter::REJECTED) {
+          sample.rejected = true;
+          n_rejected++;
+        }
+      }
 
-      ViconDataStreamSDK::CPP::Output_GetSegmentGlobalTranslation trans = 
-        client.GetSegmentGlobalTranslation(subject_name, segment_name);
-      ViconDataStreamSDK::CPP::Output_GetSegmentGlobalRotationQuaternion quat = 
-        client.GetSegmentGlobalRotationQuaternion(subject_name, segment_name);
+      if (!sample.seen()) {
+        if (!track.occluded) {
+          track.occluded = true;
+          track.occluded_since =
+            track.extrapolator.has_pose() ? track.extrapolator.last_time() : t;
+          track.bridged = true;
+        }
+        n_occluded++;
+        longest_occlusion = max(longest_occlusion, t - track.occluded_since);
 
-      if (trans.Result == ViconDataStreamSDK::CPP::Result::Success && 
-          quat.Result == ViconDataStreamSDK::CPP::Result::Success)
-      {
-        if (!trans.Occluded && !quat.Occluded)
+        double predicted_position[3], predicted_orientation[4];
+        if (max_extrapolation_ms_ <= 0 ||
+          !track.extrapolator.predict(
+            t, max_extrapolation_ms_ / 1000.0, predicted_position, predicted_orientation))
         {
-          transform.setOrigin(tf2::Vector3(trans.Translation[0] / 1000, 
-            trans.Translation[1] / 1000, trans.Translation[2] / 1000));
-          transform.setRotation(tf2::Quaternion(quat.Rotation[0], 
-            quat.Rotation[1], quat.Rotation[2], quat.Rotation[3]));
-
-          tracked_frame = tracked_frame_suffix_ + "/" + subject_name + "/" + segment_name;
-
-          boost::mutex::scoped_try_lock lock(segments_mutex_);
-
-          if (lock.owns_lock())
-          {
-            pub_it = segment_publishers_.find(subject_name + "/" + segment_name);
-            if (pub_it != segment_publishers_.end())
-            {
-              SegmentPublisher& seg = pub_it->second;
-
-              if (seg.is_ready)
-              {
-                transform = transform * seg.calibration_pose;
-                //
-                geometry_msgs::msg::TransformStamped tf_msg;
-                tf_msg.header.stamp = frame_time;
-                tf_msg.header.frame_id = tf_ref_frame_id_;
-                tf_msg.child_frame_id = subject_name;
-                tf_msg.transform.translation.x = transform.getOrigin().x();
-                tf_msg.transform.translation.y = transform.getOrigin().y();
-                tf_msg.transform.translation.z = transform.getOrigin().z();
-                tf_msg.transform.rotation.x = transform.getRotation().x();
-                tf_msg.transform.rotation.y = transform.getRotation().y();
-                tf_msg.transform.rotation.z = transform.getRotation().z();
-                tf_msg.transform.rotation.w = transform.getRotation().w();
-                //
-                nav_msgs::msg::Odometry odom_msg;
-                odom_msg.header = tf_msg.header;
-                odom_msg.child_frame_id = subject_name;
-                odom_msg.pose.pose.position.x = transform.getOrigin().x();
-                odom_msg.pose.pose.position.y = transform.getOrigin().y();
-                odom_msg.pose.pose.position.z = transform.getOrigin().z();
-                odom_msg.pose.pose.orientation.x = transform.getRotation().x();
-                odom_msg.pose.pose.orientation.y = transform.getRotation().y();
-                odom_msg.pose.pose.orientation.z = transform.getRotation().z();
-                odom_msg.pose.pose.orientation.w = transform.getRotation().w();
-                // TODO: Parameterize covariance
-                for(int i=0; i < 36; i++){
-                  if(i%7 == 0)
-                    odom_msg.pose.covariance[i] = 0.0001;
-                  else
-                    odom_msg.pose.covariance[i] = 0.0;
-                }
-                //
-                transforms.push_back(tf_msg);
-
-                seg.pub->publish(tf_msg);
-                seg.odom_pub->publish(odom_msg);
-              }
-            }
-            else
-            {
-              lock.unlock();
-              createSegment(subject_name, segment_name);
-            }
+          track.bridged = false;
+          if (n_unpublished++ == 0) {
+            unpublished_subject = subject_name;
           }
+          return;
         }
-        else
-        {
-          if (cnt % 100 == 0)
-            RCLCPP_WARN(this->get_logger(), "[%s] occluded, not publishing... ", subject_name.c_str());
+        sample.transform.setOrigin(
+          tf2::Vector3(predicted_position[0], predicted_position[1], predicted_position[2]));
+        sample.transform.setRotation(
+          tf2::Quaternion(
+            predicted_orientation[0], predicted_orientation[1], predicted_orientation[2],
+            predicted_orientation[3]));
+        sample.predicted = true;
+        // The error of a constant velocity prediction grows with the square of the horizon,
+        // here in frames
+        double horizon = (t - track.extrapolator.last_time()) * frame_rate_;
+        sample.variance_scale = (1.0 + horizon) * (1.0 + horizon);
+        n_predicted++;
+      } else {
+        if (track.occluded) {
+          track.occluded = false;
+          ended_occlusions.emplace_back(t - track.occluded_since, track.bridged);
+        }
+        sample.transform.setOrigin(tf2::Vector3(position[0], position[1], position[2]));
+        sample.transform.setRotation(
+          tf2::Quaternion(orientation[0], orientation[1], orientation[2], orientation[3]));
+        track.extrapolator.update(t, position, orientation);
+        if (twist_enabled_) {
+          twist_estimator_.set_pose(track.twist_body, position, orientation);
         }
       }
-      else
-      {
-        RCLCPP_WARN(this->get_logger(), "GetSegmentGlobalTranslation/Rotation failed (result = %s, %s), not publishing...",
+
+      if (lock.owns_lock()) {
+        SegmentMap::iterator pub_it = segment_publishers_.find(segment_key);
+        if (pub_it != segment_publishers_.end()) {
+          sample.publisher = &pub_it->second;
+        } else {
+          new_segments.emplace_back(subject_name, segment_name);
+        }
+      }
+    };
+
+    for (unsigned int i_subjects = 0; i_subjects < n_subjects; i_subjects++) {
+      std::string subject_name = client.GetSubjectName(i_subjects).SubjectName;
+      unsigned int n_segments = client.GetSegmentCount(subject_name).SegmentCount;
+      // Read once for all the segments of the subject
+      ViconDataStreamSDK::CPP::Output_GetObjectQuality OutputQuality =
+        client.GetObjectQuality(subject_name);
+      double quality = OutputQuality.Result == ViconDataStreamSDK::CPP::Result::Success ?
+        OutputQuality.Quality : -1.0;
+
+      for (unsigned int i_segments = 0; i_segments < n_segments; i_segments++) {
+        std::string segment_name = client.GetSegmentName(subject_name, i_segments).SegmentName;
+
+        ViconDataStreamSDK::CPP::Output_GetSegmentGlobalTranslation trans =
+          client.GetSegmentGlobalTranslation(subject_name, segment_name);
+        ViconDataStreamSDK::CPP::Output_GetSegmentGlobalRotationQuaternion quat =
+          client.GetSegmentGlobalRotationQuaternion(subject_name, segment_name);
+
+        if (trans.Result != ViconDataStreamSDK::CPP::Result::Success ||
+          quat.Result != ViconDataStreamSDK::CPP::Result::Success)
+        {
+          RCLCPP_WARN(
+            this->get_logger(),
+            "GetSegmentGlobalTranslation/Rotation failed (result = %s, %s), not publishing...",
             Enum2String(trans.Result).c_str(), Enum2String(quat.Result).c_str());
+          continue;
+        }
+
+        add_sample(
+          subject_name, segment_name, trans.Translation, quat.Rotation,
+          trans.Occluded || quat.Occluded, quality, -1.0);
+      }
+    }
+
+    // The marker clusters, solved by process_markers, as single segment subjects
+    for (const MarkerCluster & cluster : marker_clusters_) {
+      add_sample(
+        cluster.name(), cluster.name(), cluster.position(), cluster.orientation(),
+        !cluster.solved(), -1.0, cluster.solved() ? cluster.residual() / 1000 : -1.0);
+    }
+  }
+  segment_samples_.resize(n_samples);
+
+  for (const auto & segment : new_segments) {
+    createSegment(segment.first, segment.second);
+  }
+
+  if (twist_enabled_) {
+    twist_estimator_.update(t);
+    for (SegmentSample & sample : segment_samples_) {
+      sample.has_twist = twist_estimator_.twist(
+        sample.twist_body, sample.linear_velocity, sample.angular_velocity,
+        sample.twist_variance);
+    }
+  }
+
+  subject_pool_.run(
+    n_samples, [this, &frame_time](size_t i) {publish_segment(segment_samples_[i], frame_time);});
+
+  std::unique_ptr<vicon2_msgs::msg::SegmentBatch> predicted_msg;
+  if (publish_predicted_poses_) {
+    predicted_msg = std::make_unique<vicon2_msgs::msg::SegmentBatch>();
+    predicted_msg->header.stamp =
+      frame_time + rclcpp::Duration(std::chrono::duration<double>(prediction_horizon_));
+    predicted_msg->header.frame_id = tf_ref_frame_id_;
+    predicted_msg->frame_number = static_cast<uint32_t>(lastFrameNumber_);
+  }
+  std::vector<PredictionError> prediction_errors;
+
+  std::vector<geometry_msgs::msg::TransformStamped> transforms;
+  for (const SegmentSample & sample : segment_samples_) {
+    if (sample.has_tf) {
+      transforms.push_back(sample.tf_msg);
+    }
+
+    PredictionError prediction_error;
+    if (evaluate_prediction_ && evaluate_prediction(sample, t, prediction_error)) {
+      prediction_errors.push_back(prediction_error);
+    }
+
+    if (predicted_msg && sample.has_prediction) {
+      vicon2_msgs::msg::SegmentPose segment_msg;
+      segment_msg.subject_name = sample.subject_name;
+      segment_msg.segment_name = sample.segment_name;
+      segment_msg.occluded = !sample.seen();
+      segment_msg.predicted = true;
+      segment_msg.quality = sample.quality;
+      segment_msg.residual = sample.residual;
+      const tf2::Transform & predicted = sample.predicted_transform;
+      segment_msg.pose.position.x = predicted.getOrigin().x();
+      segment_msg.pose.position.y = predicted.getOrigin().y();
+      segment_msg.pose.position.z = predicted.getOrigin().z();
+      segment_msg.pose.orientation.x = predicted.getRotation().x();
+      segment_msg.pose.orientation.y = predicted.getRotation().y();
+      segment_msg.pose.orientation.z = predicted.getRotation().z();
+      segment_msg.pose.orientation.w = predicted.getRotation().w();
+      predicted_msg->segments.push_back(segment_msg);
+    }
+
+    if (batch_msg) {
+      vicon2_msgs::msg::SegmentPose segment_msg;
+      segment_msg.subject_name = sample.subject_name;
+      segment_msg.segment_name = sample.segment_name;
+      segment_msg.occluded = !sample.seen();
+      segment_msg.predicted = sample.predicted;
+      segment_msg.quality = sample.quality;
+      segment_msg.residual = sample.residual;
+      if (segment_msg.occluded && !sample.predicted) {
+        segment_msg.pose.orientation.w = 1.0;
+      } else {
+        segment_msg.pose.position.x = sample.transform.getOrigin().x();
+        segment_msg.pose.position.y = sample.transform.getOrigin().y();
+        segment_msg.pose.position.z = sample.transform.getOrigin().z();
+        segment_msg.pose.orientation.x = sample.transform.getRotation().x();
+        segment_msg.pose.orientation.y = sample.transform.getRotation().y();
+        segment_msg.pose.orientation.z = sample.transform.getRotation().z();
+        segment_msg.pose.orientation.w = sample.transform.getRotation().w();
       }
+      batch_msg->segments.push_back(segment_msg);
     }
   }
 
-  if(broadcast_tf_)
+  if (n_unpublished > 0) {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), steady_clock_, 5000,
+      "[%s] occluded, not publishing... (%u segments not published)",
+      unpublished_subject.c_str(), n_unpublished);
+  }
+  if (n_low_quality > 0) {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), steady_clock_, 5000,
+      "%u segments below min_object_quality (%.2f)", n_low_quality, min_object_quality_);
+  }
+
+  {
+    boost::mutex::scoped_lock lock(capture_stats_mutex_);
+    low_quality_count_ += n_low_quality;
+    occluded_segments_ = n_occluded;
+    longest_occlusion_ = longest_occlusion;
+    predicted_pose_count_ += n_predicted;
+    flipped_pose_count_ += n_flipped;
+    rejected_pose_count_ += n_rejected;
+    for (const PredictionError & error : prediction_errors) {
+      evaluated_prediction_count_++;
+      prediction_position_error_.add(error.position);
+      prediction_orientation_error_.add(error.orientation);
+      unpredicted_position_error_.add(error.last_position);
+      unpredicted_orientation_error_.add(error.last_orientation);
+    }
+    for (const auto & occlusion : ended_occlusions) {
+      occlusion_durations_.add(occlusion.first);
+      occlusion_count_++;
+      if (occlusion.second) {
+        bridged_occlusion_count_++;
+      }
+    }
+  }
+
+  if (broadcast_tf_) {
     tf_broadcaster_->sendTransform(transforms);
+  }
+  if (predicted_msg) {
+    predicted_batch_pub_->publish(std::move(predicted_msg));
+  }
+}
+
+// Publishes the pose and odometry of a visible segment whose publishers are ready. Runs in the
+// subject workers, so it only touches its own sample.
+void ViconDriverNode::publish_segment(SegmentSample & sample, const rclcpp::Time & frame_time)
+{
+  if ((!sample.seen() && !sample.predicted) || !sample.publisher ||
+    !sample.publisher->is_ready)
+  {
+    return;
+  }
+  SegmentPublisher & seg = *sample.publisher;
+  // Offset of the calibrated origin from the segment origin, in the world frame
+  tf2::Vector3 calibration_offset = sample.transform.getBasis() * seg.calibration_pose.getOrigin();
+  sample.transform = sample.transform * seg.calibration_pose;
+  const tf2::Transform & transform = sample.transform;
+
+  auto tf_msg = std::make_unique<geometry_msgs::msg::TransformStamped>();
+  tf_msg->header.stamp = frame_time;
+  tf_msg->header.frame_id = tf_ref_frame_id_;
+  tf_msg->child_frame_id = sample.subject_name;
+  tf_msg->transform.translation.x = transform.getOrigin().x();
+  tf_msg->transform.translation.y = transform.getOrigin().y();
+  tf_msg->transform.translation.z = transform.getOrigin().z();
+  tf_msg->transform.rotation.x = transform.getRotation().x();
+  tf_msg->transform.rotation.y = transform.getRotation().y();
+  tf_msg->transform.rotation.z = transform.getRotation().z();
+  tf_msg->transform.rotation.w = transform.getRotation().w();
+  //
+  auto odom_msg = std::make_unique<nav_msgs::msg::Odometry>();
+  odom_msg->header = tf_msg->header;
+  odom_msg->child_frame_id = sample.subject_name;
+  odom_msg->pose.pose.position.x = transform.getOrigin().x();
+  odom_msg->pose.pose.position.y = transform.getOrigin().y();
+  odom_msg->pose.pose.position.z = transform.getOrigin().z();
+  odom_msg->pose.pose.orientation.x = transform.getRotation().x();
+  odom_msg->pose.pose.orientation.y = transform.getRotation().y();
+  odom_msg->pose.pose.orientation.z = transform.getRotation().z();
+  odom_msg->pose.pose.orientation.w = transform.getRotation().w();
+  // The variance grows as the object quality of the subject drops, and with the horizon of
+  // predicted poses. That of a marker cluster is at least its squared residual.
+  double variance = pose_variance_ * sample.variance_scale;
+  if (sample.quality >= 0.0 && !sample.predicted) {
+    variance /= max(sample.quality, 0.01);
+  }
+  if (sample.residual >= 0.0 && !sample.predicted) {
+    variance = max(variance, sample.residual * sample.residual);
+  }
+  for (int i = 0; i < 36; i++) {
+    if (i % 7 == 0) {
+      odom_msg->pose.covariance[i] = variance;
+    } else {
+      odom_msg->pose.covariance[i] = 0.0;
+    }
+  }
+  if (sample.has_twist) {
+    // The twist is estimated at the segment origin in the world frame, the odometry gives it at
+    // the calibrated origin in the child frame
+    tf2::Vector3 angular(
+      sample.angular_velocity[0], sample.angular_velocity[1], sample.angular_velocity[2]);
+    tf2::Vector3 linear(
+      sample.linear_velocity[0], sample.linear_velocity[1], sample.linear_velocity[2]);
+    linear += angular.cross(calibration_offset);
+
+    if (publish_predicted_poses_ || evaluate_prediction_) {
+      const double position[3] = {
+        transform.getOrigin().x(), transform.getOrigin().y(), transform.getOrigin().z()};
+      const tf2::Quaternion rotation = transform.getRotation();
+      const double orientation[4] = {rotation.x(), rotation.y(), rotation.z(), rotation.w()};
+      const double linear_velocity[3] = {linear.x(), linear.y(), linear.z()};
+      const double angular_velocity[3] = {angular.x(), angular.y(), angular.z()};
+      double predicted_position[3], predicted_orientation[4];
+      predict_pose(
+        position, orientation, linear_velocity, angular_velocity, prediction_horizon_,
+        predicted_position, predicted_orientation);
+      sample.predicted_transform.setOrigin(
+        tf2::Vector3(predicted_position[0], predicted_position[1], predicted_position[2]));
+      sample.predicted_transform.setRotation(
+        tf2::Quaternion(
+          predicted_orientation[0], predicted_orientation[1], predicted_orientation[2],
+          predicted_orientation[3]));
+      sample.has_prediction = true;
+    }
 
-  cnt++;
+    tf2::Matrix3x3 to_child = transform.getBasis().transpose();
+    linear = to_child * linear;
+    angular = to_child * angular;
+    odom_msg->twist.twist.linear.x = linear.x();
+    odom_msg->twist.twist.linear.y = linear.y();
+    odom_msg->twist.twist.linear.z = linear.z();
+    odom_msg->twist.twist.angular.x = angular.x();
+    odom_msg->twist.twist.angular.y = angular.y();
+    odom_msg->twist.twist.angular.z = angular.z();
+
+    const double * v = sample.twist_variance;
+    tf2::Matrix3x3 linear_covariance(v[0], 0.0, 0.0, 0.0, v[1], 0.0, 0.0, 0.0, v[2]);
+    tf2::Matrix3x3 angular_covariance(v[3], 0.0, 0.0, 0.0, v[4], 0.0, 0.0, 0.0, v[5]);
+    linear_covariance = to_child * linear_covariance * transform.getBasis();
+    angular_covariance = to_child * angular_covariance * transform.getBasis();
+    for (int row = 0; row < 3; row++) {
+      for (int col = 0; col < 3; col++) {
+        odom_msg->twist.covariance[row * 6 + col] = linear_covariance[row][col];
+        odom_msg->twist.covariance[(row + 3) * 6 + col + 3] = angular_covariance[row][col];
+      }
+    }
+  }
+  //
+  if (broadcast_tf_) {
+    sample.tf_msg = *tf_msg;
+    sample.has_tf = true;
+  }
+
+  // Ownership is handed over so intra-process subscribers get the message
+  // without a copy or serialization
+  seg.pub->publish(std::move(tf_msg));
+  seg.odom_pub->publish(std::move(odom_msg));
 }
 
-// Transform the information provided by the Vicon system into vicon_msgs and publish the information
-void ViconDriverNode::process_markers(const rclcpp::Time & frame_time, unsigned int vicon_frame_num)
+// Compares the pose of a segment seen in this frame with the one predicted for it, and keeps
+// the prediction made from it until the frame it is for
+bool ViconDriverNode::evaluate_prediction(
+  const SegmentSample & sample, double frame_clock, PredictionError & error)
 {
-  int marker_cnt = 0;
-  if (!marker_data_enabled_) {
-    marker_data_enabled_ = true;
-    client.EnableMarkerData();
+  if (!sample.track || !sample.has_prediction) {
+    return false;
+  }
+  const tf2::Vector3 & origin = sample.transform.getOrigin();
+  const tf2::Quaternion rotation = sample.transform.getRotation();
+  const double position[3] = {origin.x(), origin.y(), origin.z()};
+  const double orientation[4] = {rotation.x(), rotation.y(), rotation.z(), rotation.w()};
+
+  bool evaluated = false;
+  if (sample.seen()) {
+    double tolerance = frame_rate_ > 0.0 ? 0.5 / frame_rate_ : 0.005;
+    evaluated = sample.track->evaluator.observe(
+      frame_clock, tolerance, position, orientation, error);
+  }
 
-    RCLCPP_INFO(
-      get_logger(), "IsMarkerDataEnabled? %s",
-      client.IsMarkerDataEnabled().Enabled ? "true" : "false");
+  const tf2::Vector3 & predicted_origin = sample.predicted_transform.getOrigin();
+  const tf2::Quaternion predicted_rotation = sample.predicted_transform.getRotation();
+  const double predicted_position[3] = {
+    predicted_origin.x(), predicted_origin.y(), predicted_origin.z()};
+  const double predicted_orientation[4] = {
+    predicted_rotation.x(), predicted_rotation.y(), predicted_rotation.z(),
+    predicted_rotation.w()};
+  sample.track->evaluator.add(
+    frame_clock + prediction_horizon_, predicted_position, predicted_orientation, position,
+    orientation);
+  return evaluated;
+}
+
+void ViconDriverNode::diagnose_prediction(diagnostic_updater::DiagnosticStatusWrapper & stat)
+{
+  if (!evaluate_prediction_) {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Prediction evaluation disabled");
+    return;
   }
-  if (!unlabeled_marker_data_enabled_) {
-    unlabeled_marker_data_enabled_ = true;
-    client.EnableUnlabeledMarkerData();
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Evaluating the pose prediction");
+  stat.addf("Horizon (ms)", "%.1f", prediction_horizon_ * 1e3);
+  stat.add("Evaluated predictions", evaluated_prediction_count_);
+  // Since the last update, against the frames the predictions were for
+  stat.add("Recent predictions", prediction_position_error_.count());
+  stat.addf("Position error mean (mm)", "%.2f", prediction_position_error_.mean() * 1e3);
+  stat.addf("Position error max (mm)", "%.2f", prediction_position_error_.max_abs() * 1e3);
+  stat.addf(
+    "Orientation error mean (deg)", "%.3f", prediction_orientation_error_.mean() * 180.0 / M_PI);
+  stat.addf(
+    "Orientation error max (deg)", "%.3f",
+    prediction_orientation_error_.max_abs() * 180.0 / M_PI);
+  // The same without prediction, i.e. with the pose the prediction was made from
+  stat.addf(
+    "Unpredicted position error mean (mm)", "%.2f", unpredicted_position_error_.mean() * 1e3);
+  stat.addf(
+    "Unpredicted orientation error mean (deg)", "%.3f",
+    unpredicted_orientation_error_.mean() * 180.0 / M_PI);
+  prediction_position_error_.reset();
+  prediction_orientation_error_.reset();
+  unpredicted_position_error_.reset();
+  unpredicted_orientation_error_.reset();
+}
 
-    RCLCPP_INFO(
-      get_logger(), "IsUnlabeledMarkerDataEnabled? %s",
-      client.IsUnlabeledMarkerDataEnabled().Enabled ? "true" : "false");
+void ViconDriverNode::diagnose_occlusions(diagnostic_updater::DiagnosticStatusWrapper & stat)
+{
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  if (occluded_segments_ > 0) {
+    stat.summaryf(
+      diagnostic_msgs::msg::DiagnosticStatus::OK, "%u segments occluded", occluded_segments_);
+  } else {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "No segments occluded");
   }
+  stat.add("Occluded segments", occluded_segments_);
+  stat.addf("Longest current occlusion (ms)", "%.1f", longest_occlusion_ * 1e3);
+  stat.add("Max extrapolation (ms)", max_extrapolation_ms_);
+  stat.add("Predicted poses", predicted_pose_count_);
+  stat.add("Occlusions", occlusion_count_);
+  stat.add("Occlusions bridged", bridged_occlusion_count_);
+  // Occlusions ended since the last update
+  stat.add("Recent occlusions", occlusion_durations_.count());
+  stat.addf("Recent occlusion mean (ms)", "%.1f", occlusion_durations_.mean() * 1e3);
+  stat.addf("Recent occlusion max (ms)", "%.1f", occlusion_durations_.max_abs() * 1e3);
+  occlusion_durations_.reset();
+}
+
+// The calibration is static, so it is only read after connecting, when the number of cameras
+// changes or every camera_calibration_refresh_s, and only published when it changed
+void ViconDriverNode::process_camera_calibration(const rclcpp::Time & frame_time)
+{
+  unsigned int CameraCount = client.GetCameraCount().CameraCount;
+  auto now = std::chrono::steady_clock::now();
+  if (camera_calibration_valid_ && CameraCount == camera_count_ &&
+    (camera_calibration_refresh_s_ <= 0.0 ||
+    std::chrono::duration<double>(now - camera_calibration_time_).count() <
+    camera_calibration_refresh_s_))
+  {
+    return;
+  }
+  camera_calibration_valid_ = true;
+  camera_count_ = CameraCount;
+  camera_calibration_time_ = now;
+
+  auto calibration_msg = std::make_unique<vicon2_msgs::msg::CameraCalibrations>();
+  for (unsigned int CameraIndex = 0; CameraIndex < CameraCount; ++CameraIndex) {
+    std::string camera_name = client.GetCameraName(CameraIndex).CameraName;
+
+    vicon2_msgs::msg::CameraCalibration camera_msg;
+    camera_msg.name = camera_name;
+    camera_msg.id = client.GetCameraId(camera_name).CameraId;
+    camera_msg.user_id = client.GetCameraUserId(camera_name).CameraUserId;
+    camera_msg.display_name = client.GetCameraDisplayName(camera_name).CameraDisplayName;
+    camera_msg.type = client.GetCameraType(camera_name).CameraType;
+    camera_msg.is_video_camera = client.GetIsVideoCamera(camera_name).IsVideoCamera;
+
+    ViconDataStreamSDK::CPP::Output_GetCameraResolution OutputResolution =
+      client.GetCameraResolution(camera_name);
+    camera_msg.resolution_x = OutputResolution.ResolutionX;
+    camera_msg.resolution_y = OutputResolution.ResolutionY;
+
+    ViconDataStreamSDK::CPP::Output_GetCameraGlobalTranslation OutputTranslation =
+      client.GetCameraGlobalTranslation(camera_name);
+    ViconDataStreamSDK::CPP::Output_GetCameraGlobalRotationQuaternion OutputRotation =
+      client.GetCameraGlobalRotationQuaternion(camera_name);
+    camera_msg.pose.position.x = OutputTranslation.Translation[0] / 1000;
+    camera_msg.pose.position.y = OutputTranslation.Translation[1] / 1000;
+    camera_msg.pose.position.z = OutputTranslation.Translation[2] / 1000;
+    camera_msg.pose.orientation.x = OutputRotation.Rotation[0];
+    camera_msg.pose.orientation.y = OutputRotation.Rotation[1];
+    camera_msg.pose.orientation.z = OutputRotation.Rotation[2];
+    camera_msg.pose.orientation.w = OutputRotation.Rotation[3];
+
+    camera_msg.focal_length = client.GetCameraFocalLength(camera_name).FocalLength;
+    ViconDataStreamSDK::CPP::Output_GetCameraPrincipalPoint OutputPrincipalPoint =
+      client.GetCameraPrincipalPoint(camera_name);
+    camera_msg.principal_point_x = OutputPrincipalPoint.PrincipalPointX;
+    camera_msg.principal_point_y = OutputPrincipalPoint.PrincipalPointY;
+    ViconDataStreamSDK::CPP::Output_GetCameraLensParameters OutputLensParameters =
+      client.GetCameraLensParameters(camera_name);
+    if (OutputLensParameters.Result == ViconDataStreamSDK::CPP::Result::Success) {
+      for (size_t i = 0; i < camera_msg.lens_parameters.size(); i++) {
+        camera_msg.lens_parameters[i] = OutputLensParameters.LensParameters[i];
+      }
+    }
+    calibration_msg->cameras.push_back(camera_msg);
+  }
+
+  if (calibration_msg->cameras == camera_calibration_) {
+    return;
+  }
+  camera_calibration_ = calibration_msg->cameras;
+  RCLCPP_INFO(get_logger(), "Camera calibration of %u cameras updated", CameraCount);
+
+  calibration_msg->header.stamp = frame_time;
+  calibration_msg->header.frame_id = tf_ref_frame_id_;
+  camera_calibration_pub_->publish(std::move(calibration_msg));
+}
+
+void ViconDriverNode::update_camera_list()
+{
+  unsigned int CameraCount = client.GetCameraCount().CameraCount;
+  if (camera_list_valid_ && CameraCount == camera_names_.size()) {
+    return;
+  }
+  camera_names_.clear();
+  camera_ids_.clear();
+  camera_is_video_.clear();
+  for (unsigned int CameraIndex = 0; CameraIndex < CameraCount; ++CameraIndex) {
+    std::string camera_name = client.GetCameraName(CameraIndex).CameraName;
+    camera_ids_.push_back(client.GetCameraId(camera_name).CameraId);
+    camera_is_video_.push_back(client.GetIsVideoCamera(camera_name).IsVideoCamera);
+    camera_names_.push_back(camera_name);
+  }
+  camera_list_valid_ = true;
+
+  // Runs only while active, so new publishers are activated right away
+  for (size_t i = 0; i < camera_ids_.size(); i++) {
+    if (!is_streamed_video_camera(i) || video_pubs_.count(camera_ids_[i])) {
+      continue;
+    }
+    auto video_pub = create_publisher<sensor_msgs::msg::Image>(
+      tracked_frame_suffix_ + "/video/camera_" + std::to_string(camera_ids_[i]),
+      rclcpp::QoS(max(video_qos_depth_, 1)).best_effort());
+    video_pub->on_activate();
+    video_pubs_[camera_ids_[i]] = video_pub;
+  }
+}
+
+// Whether the video of camera (index in the camera list) is published
+bool ViconDriverNode::is_streamed_video_camera(size_t camera) const
+{
+  return publish_video_ && camera_is_video_[camera] &&
+         (video_camera_ids_.empty() ||
+         std::find(
+           video_camera_ids_.begin(), video_camera_ids_.end(),
+           static_cast<int64_t>(camera_ids_[camera])) != video_camera_ids_.end());
+}
+
+// Restricts the cameras whose centroids, blobs and video are streamed. The server sends every
+// camera when no filter is set, so it is only applied when cameras are given; the data types
+// enabled without a camera list then get all the (video) cameras. Needs the camera list, so it
+// is applied with the first frame.
+void ViconDriverNode::set_camera_filter()
+{
+  camera_filter_pending_ = false;
+  if (centroid_camera_ids_.empty() && greyscale_camera_ids_.empty() &&
+    video_camera_ids_.empty())
+  {
+    return;
+  }
+  update_camera_list();
+
+  std::vector<unsigned int> centroid_cameras, blob_cameras, video_cameras;
+  if (publish_centroids_) {
+    centroid_cameras = centroid_camera_ids_.empty() ? camera_ids_ :
+      std::vector<unsigned int>(centroid_camera_ids_.begin(), centroid_camera_ids_.end());
+  }
+  if (publish_greyscale_blobs_) {
+    blob_cameras = greyscale_camera_ids_.empty() ? camera_ids_ :
+      std::vector<unsigned int>(greyscale_camera_ids_.begin(), greyscale_camera_ids_.end());
+  }
+  for (size_t i = 0; i < camera_ids_.size(); i++) {
+    if (is_streamed_video_camera(i)) {
+      video_cameras.push_back(camera_ids_[i]);
+    }
+  }
+  ViconDataStreamSDK::CPP::Result::Enum result = client.SetCameraFilter(
+    centroid_cameras, blob_cameras, video_cameras).Result;
+  RCLCPP_INFO(
+    get_logger(), "Setting camera filter (%zu centroid, %zu blob, %zu video cameras) : %s",
+    centroid_cameras.size(), blob_cameras.size(), video_cameras.size(),
+    Enum2String(result).c_str());
+}
+
+// Publishes the centroids of every camera in one message of flat arrays
+void ViconDriverNode::process_centroids(
+  const rclcpp::Time & frame_time, unsigned int vicon_frame_num)
+{
+  update_camera_list();
+
+  auto centroids_msg = std::make_unique<vicon2_msgs::msg::Centroids>();
+  centroids_msg->header.stamp = frame_time;
+  centroids_msg->frame_number = vicon_frame_num;
+  centroids_msg->camera_id.reserve(centroid_count_);
+  centroids_msg->x.reserve(centroid_count_);
+  centroids_msg->y.reserve(centroid_count_);
+  centroids_msg->radius.reserve(centroid_count_);
+  centroids_msg->weight.reserve(centroid_count_);
+
+  for (size_t i = 0; i < camera_names_.size(); i++) {
+    const std::string & camera_name = camera_names_[i];
+    unsigned int CentroidCount = client.GetCentroidCount(camera_name).CentroidCount;
+    for (unsigned int CentroidIndex = 0; CentroidIndex < CentroidCount; ++CentroidIndex) {
+      ViconDataStreamSDK::CPP::Output_GetCentroidPosition OutputPosition =
+        client.GetCentroidPosition(camera_name, CentroidIndex);
+      if (OutputPosition.Result != ViconDataStreamSDK::CPP::Result::Success) {
+        continue;
+      }
+      centroids_msg->camera_id.push_back(camera_ids_[i]);
+      centroids_msg->x.push_back(OutputPosition.CentroidPosition[0]);
+      centroids_msg->y.push_back(OutputPosition.CentroidPosition[1]);
+      centroids_msg->radius.push_back(OutputPosition.Radius);
+      centroids_msg->weight.push_back(client.GetCentroidWeight(camera_name, CentroidIndex).Weight);
+    }
+  }
+  centroid_count_ = centroids_msg->x.size();
+  centroids_pub_->publish(std::move(centroids_msg));
+}
+
+// Reads the blobs of the selected cameras. The data is moved, not copied, into a job, and
+// packing and publishing are left to the blob worker.
+void ViconDriverNode::process_greyscale_blobs(
+  const rclcpp::Time & frame_time, unsigned int vicon_frame_num)
+{
+  update_camera_list();
+
+  auto job = std::make_unique<GreyscaleBlobsJob>();
+  job->frame_time = frame_time;
+  job->frame_number = vicon_frame_num;
+  for (size_t i = 0; i < camera_names_.size(); i++) {
+    if (!greyscale_camera_ids_.empty() &&
+      std::find(
+        greyscale_camera_ids_.begin(), greyscale_camera_ids_.end(),
+        static_cast<int64_t>(camera_ids_[i])) == greyscale_camera_ids_.end())
+    {
+      continue;
+    }
+    const std::string & camera_name = camera_names_[i];
+    unsigned int BlobCount = client.GetGreyscaleBlobCount(camera_name).BlobCount;
+    if (BlobCount == 0) {
+      continue;
+    }
+    job->camera_ids.push_back(camera_ids_[i]);
+    job->subsample_info.push_back(client.GetGreyscaleBlobSubsampleInfo(camera_name));
+    job->blobs.emplace_back();
+    job->blobs.back().reserve(BlobCount);
+    for (unsigned int BlobIndex = 0; BlobIndex < BlobCount; ++BlobIndex) {
+      job->blobs.back().push_back(client.GetGreyscaleBlob(camera_name, BlobIndex));
+    }
+  }
+  blob_worker_.post(std::move(job));
+}
+
+// Runs in the blob worker: packs the blobs of a frame in a single buffer with offsets
+void ViconDriverNode::pack_greyscale_blobs(GreyscaleBlobsJob & job)
+{
+  size_t n_blobs = 0, n_lines = 0, n_pixels = 0;
+  for (const auto & camera_blobs : job.blobs) {
+    n_blobs += camera_blobs.size();
+    for (const auto & blob : camera_blobs) {
+      n_lines += blob.BlobLinePixelValues.size();
+      for (const auto & line : blob.BlobLinePixelValues) {
+        n_pixels += line.size();
+      }
+    }
+  }
+
+  auto blobs_msg = std::make_unique<vicon2_msgs::msg::GreyscaleBlobs>();
+  blobs_msg->header.stamp = job.frame_time;
+  blobs_msg->frame_number = job.frame_number;
+  blobs_msg->camera_id = job.camera_ids;
+  blobs_msg->blob_camera_index.reserve(n_blobs);
+  blobs_msg->blob_line_offset.reserve(n_blobs);
+  blobs_msg->line_x.reserve(n_lines);
+  blobs_msg->line_y.reserve(n_lines);
+  blobs_msg->line_pixel_offset.reserve(n_lines);
+  blobs_msg->pixels.reserve(n_pixels);
+
+  for (size_t camera = 0; camera < job.camera_ids.size(); camera++) {
+    const ViconDataStreamSDK::CPP::Output_GetGreyscaleBlobSubsampleInfo & info =
+      job.subsample_info[camera];
+    blobs_msg->twice_offset_x.push_back(info.TwiceOffsetX);
+    blobs_msg->twice_offset_y.push_back(info.TwiceOffsetY);
+    blobs_msg->sensor_pixels_per_image_pixel_x.push_back(info.SensorPixelsPerImagePixelX);
+    blobs_msg->sensor_pixels_per_image_pixel_y.push_back(info.SensorPixelsPerImagePixelY);
+
+    for (const auto & blob : job.blobs[camera]) {
+      blobs_msg->blob_camera_index.push_back(camera);
+      blobs_msg->blob_line_offset.push_back(blobs_msg->line_x.size());
+      for (size_t line = 0; line < blob.BlobLinePixelValues.size(); line++) {
+        blobs_msg->line_x.push_back(blob.BlobLinePositionsX[line]);
+        blobs_msg->line_y.push_back(blob.BlobLinePositionsY[line]);
+        blobs_msg->line_pixel_offset.push_back(blobs_msg->pixels.size());
+        blobs_msg->pixels.insert(
+          blobs_msg->pixels.end(),
+          blob.BlobLinePixelValues[line].begin(), blob.BlobLinePixelValues[line].end());
+      }
+    }
+  }
+  greyscale_blobs_pub_->publish(std::move(blobs_msg));
+}
+
+// Takes the video frames of the selected cameras. Only the shared pointers to the pixels are
+// copied here, the images are filled and published by the video worker.
+void ViconDriverNode::process_video(const rclcpp::Time & frame_time)
+{
+  update_camera_list();
+
+  auto job = std::make_unique<VideoJob>();
+  job->frame_time = frame_time;
+  for (size_t i = 0; i < camera_names_.size(); i++) {
+    if (!is_streamed_video_camera(i)) {
+      continue;
+    }
+    ViconDataStreamSDK::CPP::Output_GetVideoFrame OutputVideoFrame =
+      client.GetVideoFrame(camera_names_[i]);
+    if (OutputVideoFrame.Result != ViconDataStreamSDK::CPP::Result::Success ||
+      !OutputVideoFrame.m_Data)
+    {
+      continue;
+    }
+    job->camera_names.push_back(camera_names_[i]);
+    job->frames.push_back(OutputVideoFrame);
+    job->pubs.push_back(video_pubs_[camera_ids_[i]]);
+  }
+  if (!job->frames.empty()) {
+    video_worker_.post(std::move(job));
+  }
+}
+
+// Runs in the video worker: publishes every frame in the image topic of its camera, stamped
+// with the Vicon frame it came with. Image is unbounded, so most RMWs can not loan it (the
+// "loan" would be an allocation and a copy more), and loans can not go through intra-process,
+// where publishing one throws. The images are only loaned where the RMW really can and
+// intra-process is off; LifecyclePublisher hides the loaned publish of rclcpp::Publisher, so
+// the activation is checked here and the base one used.
+void ViconDriverNode::publish_video(VideoJob & job)
+{
+  bool intra_process = get_node_options().use_intra_process_comms();
+  for (size_t i = 0; i < job.frames.size(); i++) {
+    auto & video_pub = job.pubs[i];
+    if (!video_pub->is_activated()) {
+      continue;
+    }
+    if (!intra_process && video_pub->can_loan_messages()) {
+      auto image_msg = video_pub->borrow_loaned_message();
+      if (fill_video_image(job, i, image_msg.get())) {
+        video_pub->rclcpp::Publisher<sensor_msgs::msg::Image>::publish(std::move(image_msg));
+      }
+    } else {
+      auto image_msg = std::make_unique<sensor_msgs::msg::Image>();
+      if (fill_video_image(job, i, *image_msg)) {
+        video_pub->publish(std::move(image_msg));
+      }
+    }
+  }
+}
+
+// Fills the image of the frame i of job, false if its format is not supported
+bool ViconDriverNode::fill_video_image(
+  const VideoJob & job, size_t i, sensor_msgs::msg::Image & image)
+{
+  if (!fill_image(job.frames[i], image)) {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), steady_clock_, 5000, "Unsupported video frame from camera %s",
+      job.camera_names[i].c_str());
+    return false;
+  }
+  image.header.stamp = job.frame_time;
+  image.header.frame_id = job.camera_names[i];
+  return true;
+}
+
+// Adds the gaze of every eye tracker to the segment batch of the frame, next to the pose of the
+// head segment it is mounted on
+void ViconDriverNode::process_eye_trackers(vicon2_msgs::msg::SegmentBatch & batch_msg)
+{
+  unsigned int EyeTrackerCount = client.GetEyeTrackerCount().EyeTrackerCount;
+  for (unsigned int EyeTrackerIndex = 0; EyeTrackerIndex < EyeTrackerCount; ++EyeTrackerIndex) {
+    ViconDataStreamSDK::CPP::Output_GetEyeTrackerGlobalPosition OutputPosition =
+      client.GetEyeTrackerGlobalPosition(EyeTrackerIndex);
+    ViconDataStreamSDK::CPP::Output_GetEyeTrackerGlobalGazeVector OutputGaze =
+      client.GetEyeTrackerGlobalGazeVector(EyeTrackerIndex);
+
+    vicon2_msgs::msg::Gaze gaze_msg;
+    gaze_msg.eye_tracker_index = EyeTrackerIndex;
+    if (EyeTrackerIndex < eye_tracker_segments_.size()) {
+      const std::string & segment = eye_tracker_segments_[EyeTrackerIndex];
+      size_t separator = segment.find('/');
+      gaze_msg.subject_name = segment.substr(0, separator);
+      if (separator != std::string::npos) {
+        gaze_msg.segment_name = segment.substr(separator + 1);
+      }
+    }
+    gaze_msg.position.x = OutputPosition.Position[0] / 1000;
+    gaze_msg.position.y = OutputPosition.Position[1] / 1000;
+    gaze_msg.position.z = OutputPosition.Position[2] / 1000;
+    gaze_msg.gaze.x = OutputGaze.GazeVector[0];
+    gaze_msg.gaze.y = OutputGaze.GazeVector[1];
+    gaze_msg.gaze.z = OutputGaze.GazeVector[2];
+    gaze_msg.occluded = OutputPosition.Result != ViconDataStreamSDK::CPP::Result::Success ||
+      OutputGaze.Result != ViconDataStreamSDK::CPP::Result::Success ||
+      OutputPosition.Occluded || OutputGaze.Occluded;
+    batch_msg.gazes.push_back(gaze_msg);
+  }
+}
+
+// Transform the information provided by the Vicon system into vicon_msgs and publish the information
+// The unlabeled markers are tracked at frame_clock (s), the Vicon clock of the frame.
+void ViconDriverNode::process_markers(
+  const rclcpp::Time & frame_time, double frame_clock, unsigned int vicon_frame_num)
+{
+  int marker_cnt = 0;
   n_markers_ = 0;
-  mocap_msgs::msg::Markers markers_msg;
-  markers_msg.header.stamp = frame_time;
-  markers_msg.frame_number = vicon_frame_num;
+  auto markers_msg = std::make_unique<mocap_msgs::msg::Markers>();
+  markers_msg->header.stamp = frame_time;
+  markers_msg->frame_number = vicon_frame_num;
+
+  // The rays take two more SDK calls per marker and ray, only read them when someone listens
+  std::unique_ptr<vicon2_msgs::msg::MarkerRays> rays_msg;
+  if (publish_marker_rays_ && marker_rays_pub_->get_subscription_count() > 0) {
+    rays_msg = std::make_unique<vicon2_msgs::msg::MarkerRays>();
+    rays_msg->header.stamp = frame_time;
+    rays_msg->frame_number = vicon_frame_num;
+  }
 
-  // Count the number of subjects
-  unsigned int SubjectCount = client.GetSubjectCount().SubjectCount;
   // Get labeled markers
-  for (unsigned int SubjectIndex = 0; SubjectIndex < SubjectCount; ++SubjectIndex)
-  {
-    std::string this_subject_name = client.GetSubjectName(SubjectIndex).SubjectName;
-    // Count the number of markers
-    unsigned int num_subject_markers = client.GetMarkerCount(this_subject_name).MarkerCount;
-    n_markers_ += num_subject_markers;
-    //std::cout << "    Markers (" << MarkerCount << "):" << std::endl;
-    for (unsigned int MarkerIndex = 0; MarkerIndex < num_subject_markers; ++MarkerIndex)
-    {
-      mocap_msgs::msg::Marker this_marker;
-      this_marker.marker_name = client.GetMarkerName(this_subject_name, MarkerIndex).MarkerName;
-      this_marker.subject_name = this_subject_name;
-      this_marker.segment_name
-          = client.GetMarkerParentName(this_subject_name, this_marker.marker_name).SegmentName;
-
-      // Get the global marker translation
-      ViconDataStreamSDK::CPP::Output_GetMarkerGlobalTranslation _Output_GetMarkerGlobalTranslation =
-          client.GetMarkerGlobalTranslation(this_subject_name, this_marker.marker_name);
-
-      this_marker.translation.x = _Output_GetMarkerGlobalTranslation.Translation[0];
-      this_marker.translation.y = _Output_GetMarkerGlobalTranslation.Translation[1];
-      this_marker.translation.z = _Output_GetMarkerGlobalTranslation.Translation[2];
-      this_marker.occluded = _Output_GetMarkerGlobalTranslation.Occluded;
-
-      markers_msg.markers.push_back(this_marker);
+  if (labeled_markers_by_index_) {
+    labeled_marker_index_.read(client, markers_msg->markers);
+    check_labeled_marker_index();
+  } else {
+    LabeledMarkerIndex::read_by_name(client, markers_msg->markers);
+  }
+  n_markers_ = markers_msg->markers.size();
+
+  if (rays_msg) {
+    for (const auto & marker : markers_msg->markers) {
+      unsigned int RayCount = marker.occluded ? 0 : client.GetMarkerRayContributionCount(
+        marker.subject_name, marker.marker_name).RayContributionsCount;
+      rays_msg->contribution_count.push_back(RayCount);
+      rays_msg->contribution_offset.push_back(rays_msg->camera_id.size());
+      for (unsigned int RayIndex = 0; RayIndex < RayCount; ++RayIndex) {
+        ViconDataStreamSDK::CPP::Output_GetMarkerRayContribution OutputRay =
+          client.GetMarkerRayContribution(marker.subject_name, marker.marker_name, RayIndex);
+        rays_msg->camera_id.push_back(OutputRay.CameraID);
+        rays_msg->centroid_index.push_back(OutputRay.CentroidIndex);
+      }
     }
   }
 
@@ -475,6 +2003,8 @@ void ViconDriverNode::process_markers(const rclcpp::Time & frame_time, unsigned
     // "# unlabeled markers: %d", UnlabeledMarkerCount);
   n_markers_ += UnlabeledMarkerCount;
   n_unlabeled_markers_ = UnlabeledMarkerCount;
+  size_t first_unlabeled = markers_msg->markers.size();
+  unlabeled_positions_.clear();
   for (unsigned int UnlabeledMarkerIndex = 0; UnlabeledMarkerIndex < UnlabeledMarkerCount; ++UnlabeledMarkerIndex)
   {
     // Get the global marker translationSegmentPublisher
@@ -490,11 +2020,10 @@ void ViconDriverNode::process_markers(const rclcpp::Time & frame_time, unsigned
       this_marker.translation.y = _Output_GetUnlabeledMarkerGlobalTranslation.Translation[1];
       this_marker.translation.z = _Output_GetUnlabeledMarkerGlobalTranslation.Translation[2];
       // this_marker.occluded = false;
-      markers_msg.markers.push_back(this_marker);
-
-      if(broadcast_tf_)
-        marker_to_tf(this_marker, marker_cnt, frame_time);
-      marker_cnt++;
+      markers_msg->markers.push_back(this_marker);
+      unlabeled_positions_.insert(
+        unlabeled_positions_.end(), _Output_GetUnlabeledMarkerGlobalTranslation.Translation,
+        _Output_GetUnlabeledMarkerGlobalTranslation.Translation + 3);
     } else {
       RCLCPP_WARN(
         get_logger(),
@@ -502,12 +2031,317 @@ void ViconDriverNode::process_markers(const rclcpp::Time & frame_time, unsigned
         Enum2String(_Output_GetUnlabeledMarkerGlobalTranslation.Result).c_str());
     }
   }
+
+  // The SDK gives the unlabeled markers in no particular order, the tracker keeps their ids
+  // (and so their TF frames) on the same physical marker from frame to frame
+  size_t n_unlabeled = markers_msg->markers.size() - first_unlabeled;
+  if (track_unlabeled_markers_) {
+    marker_tracker_.update(
+      frame_clock, unlabeled_positions_.data(), n_unlabeled, unlabeled_ids_);
+    boost::mutex::scoped_lock lock(capture_stats_mutex_);
+    unlabeled_track_count_ = marker_tracker_.track_count();
+    unlabeled_tracks_started_ = marker_tracker_.started();
+  }
+
+  if (!marker_clusters_.empty()) {
+    solve_marker_clusters(markers_msg->markers, first_unlabeled);
+  }
+  if (!publish_markers_) {
+    return;
+  }
+
+  for (size_t i = 0; i < n_unlabeled; i++) {
+    mocap_msgs::msg::Marker & this_marker = markers_msg->markers[first_unlabeled + i];
+    int marker_num = marker_cnt;
+    if (track_unlabeled_markers_) {
+      marker_num = static_cast<int>(unlabeled_ids_[i]);
+      this_marker.marker_name = "unlabeled_" + std::to_string(unlabeled_ids_[i]);
+    }
+    if(broadcast_tf_)
+      marker_to_tf(this_marker, marker_num, frame_time);
+    marker_cnt++;
+  }
   if (!marker_pub_->is_activated()) {
     RCLCPP_WARN(
       get_logger(),
       "Lifecycle publisher is currently inactive. Messages are not published.");
   }
-  marker_pub_->publish(markers_msg);
+  marker_pub_->publish(std::move(markers_msg));
+  if (rays_msg) {
+    marker_rays_pub_->publish(std::move(rays_msg));
+  }
+}
+
+// Reads the names of every device output component and publishes them as the device schema.
+// The frames then only carry values, in the order of the schema.
+void ViconDriverNode::resolve_device_schema(const rclcpp::Time & frame_time)
+{
+  device_channels_.clear();
+  auto schema_msg = std::make_unique<vicon2_msgs::msg::DeviceSchema>();
+
+  unsigned int DeviceCount = client.GetDeviceCount().DeviceCount;
+  for (unsigned int DeviceIndex = 0; DeviceIndex < DeviceCount; ++DeviceIndex) {
+    ViconDataStreamSDK::CPP::Output_GetDeviceName OutputDeviceName =
+      client.GetDeviceName(DeviceIndex);
+    unsigned int DeviceOutputCount =
+      client.GetDeviceOutputCount(OutputDeviceName.DeviceName).DeviceOutputCount;
+    for (unsigned int DeviceOutputIndex = 0; DeviceOutputIndex < DeviceOutputCount;
+      ++DeviceOutputIndex)
+    {
+      ViconDataStreamSDK::CPP::Output_GetDeviceOutputComponentName OutputComponentName =
+        client.GetDeviceOutputComponentName(OutputDeviceName.DeviceName, DeviceOutputIndex);
+      if (OutputComponentName.Result != ViconDataStreamSDK::CPP::Result::Success) {
+        continue;
+      }
+
+      DeviceChannel channel;
+      channel.device_name = OutputDeviceName.DeviceName;
+      channel.output_name = OutputComponentName.DeviceOutputName;
+      channel.component_name = OutputComponentName.DeviceOutputComponentName;
+      device_channels_.push_back(channel);
+
+      vicon2_msgs::msg::DeviceChannel channel_msg;
+      channel_msg.device_name = channel.device_name;
+      channel_msg.device_type = Enum2String(OutputDeviceName.DeviceType);
+      channel_msg.output_name = channel.output_name;
+      channel_msg.component_name = channel.component_name;
+      channel_msg.unit = Enum2String(OutputComponentName.DeviceOutputUnit);
+      schema_msg->channels.push_back(channel_msg);
+    }
+  }
+
+  device_count_ = DeviceCount;
+  device_schema_id_++;
+  device_schema_valid_ = true;
+  RCLCPP_INFO(
+    get_logger(), "Device schema %u: %u devices, %zu channels",
+    device_schema_id_, DeviceCount, device_channels_.size());
+
+  schema_msg->header.stamp = frame_time;
+  schema_msg->schema_id = device_schema_id_;
+  device_schema_pub_->publish(std::move(schema_msg));
+}
+
+// Publishes the subsamples of every device channel of the frame in a single numeric message
+void ViconDriverNode::process_devices(
+  const rclcpp::Time & frame_time, unsigned int vicon_frame_num)
+{
+  if (!device_schema_valid_ || client.GetDeviceCount().DeviceCount != device_count_) {
+    resolve_device_schema(frame_time);
+  }
+
+  auto device_msg = std::make_unique<vicon2_msgs::msg::DeviceFrame>();
+  device_msg->header.stamp = frame_time;
+  device_msg->frame_number = vicon_frame_num;
+  device_msg->schema_id = device_schema_id_;
+  device_msg->subsample_counts.resize(device_channels_.size());
+  device_msg->occluded.resize(device_channels_.size());
+  device_msg->values.reserve(device_values_size_);
+
+  for (size_t i = 0; i < device_channels_.size(); i++) {
+    const DeviceChannel & channel = device_channels_[i];
+    ViconDataStreamSDK::CPP::Output_GetDeviceOutputSubsamples OutputSubsamples =
+      client.GetDeviceOutputSubsamples(
+      channel.device_name, channel.output_name, channel.component_name);
+    if (OutputSubsamples.Result != ViconDataStreamSDK::CPP::Result::Success) {
+      // The devices changed in the server, the schema is resolved again in the next frame
+      device_schema_valid_ = false;
+      device_msg->occluded[i] = true;
+      continue;
+    }
+
+    device_msg->subsample_counts[i] = OutputSubsamples.DeviceOutputSubsamples;
+    device_msg->occluded[i] = OutputSubsamples.Occluded;
+    for (unsigned int Subsample = 0; Subsample < OutputSubsamples.DeviceOutputSubsamples;
+      ++Subsample)
+    {
+      device_msg->values.push_back(
+        client.GetDeviceOutputValue(
+          channel.device_name, channel.output_name, channel.component_name, Subsample).Value);
+    }
+  }
+  device_values_size_ = device_msg->values.size();
+  device_pub_->publish(std::move(device_msg));
+}
+
+// Publishes one message per force plate with all the subsamples of the frame.
+// The SDK gives forces in N, moments in N m and positions in mm, they are sent in SI units.
+// A vector the SDK could not give is sent as NaN.
+void ViconDriverNode::process_force_plates(
+  const rclcpp::Time & frame_time, unsigned int vicon_frame_num)
+{
+  unsigned int ForcePlateCount = client.GetForcePlateCount().ForcePlateCount;
+  for (unsigned int ForcePlateIndex = 0; ForcePlateIndex < ForcePlateCount; ++ForcePlateIndex) {
+    unsigned int SubsampleCount =
+      client.GetForcePlateSubsamples(ForcePlateIndex).ForcePlateSubsamples;
+
+    auto force_plate_msg = std::make_unique<vicon2_msgs::msg::ForcePlate>();
+    force_plate_msg->header.stamp = frame_time;
+    force_plate_msg->header.frame_id = tf_ref_frame_id_;
+    force_plate_msg->frame_number = vicon_frame_num;
+    force_plate_msg->plate_index = ForcePlateIndex;
+    force_plate_msg->subsample_rate = frame_rate_ * SubsampleCount;
+    force_plate_msg->subsample_count = SubsampleCount;
+    force_plate_msg->force.resize(3 * SubsampleCount);
+    force_plate_msg->moment.resize(3 * SubsampleCount);
+    force_plate_msg->centre_of_pressure.resize(3 * SubsampleCount);
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (unsigned int Subsample = 0; Subsample < SubsampleCount; ++Subsample) {
+      ViconDataStreamSDK::CPP::Output_GetGlobalForceVector OutputForce =
+        client.GetGlobalForceVector(ForcePlateIndex, Subsample);
+      ViconDataStreamSDK::CPP::Output_GetGlobalMomentVector OutputMoment =
+        client.GetGlobalMomentVector(ForcePlateIndex, Subsample);
+      ViconDataStreamSDK::CPP::Output_GetGlobalCentreOfPressure OutputCentreOfPressure =
+        client.GetGlobalCentreOfPressure(ForcePlateIndex, Subsample);
+
+      bool force_valid = OutputForce.Result == ViconDataStreamSDK::CPP::Result::Success;
+      bool moment_valid = OutputMoment.Result == ViconDataStreamSDK::CPP::Result::Success;
+      bool cop_valid =
+        OutputCentreOfPressure.Result == ViconDataStreamSDK::CPP::Result::Success;
+
+      for (unsigned int axis = 0; axis < 3; ++axis) {
+        force_plate_msg->force[3 * Subsample + axis] =
+          force_valid ? OutputForce.ForceVector[axis] : nan;
+        force_plate_msg->moment[3 * Subsample + axis] =
+          moment_valid ? OutputMoment.MomentVector[axis] : nan;
+        force_plate_msg->centre_of_pressure[3 * Subsample + axis] =
+          cop_valid ? OutputCentreOfPressure.CentreOfPressure[axis] / 1000 : nan;
+      }
+    }
+    force_plate_pub_->publish(std::move(force_plate_msg));
+  }
+}
+
+// Publishes the labeled and unlabeled markers as a point cloud, written in a single pass over
+// the SDK results. The labeled markers are read by index and keep their position in the
+// markers message as label, so they are in the cloud also when occluded. In a frame where the
+// ids are not all bound they are taken from the markers read by name.
+void ViconDriverNode::process_marker_cloud(const rclcpp::Time & frame_time)
+{
+  cloud_markers_.clear();
+  bool bound = labeled_marker_index_.bind(client, cloud_markers_);
+  check_labeled_marker_index();
+  size_t n_labeled = labeled_marker_index_.size();
+  unsigned int UnlabeledMarkerCount = client.GetUnlabeledMarkerCount().MarkerCount;
+
+  auto cloud_msg = std::make_unique<sensor_msgs::msg::PointCloud2>();
+  cloud_msg->header.stamp = frame_time;
+  cloud_msg->header.frame_id = tf_ref_frame_id_;
+  init_marker_cloud(*cloud_msg, n_labeled + UnlabeledMarkerCount);
+
+  const double no_translation[3] = {0.0, 0.0, 0.0};
+  for (size_t i = 0; i < n_labeled; i++) {
+    set_marker_point(*cloud_msg, i, no_translation, static_cast<int32_t>(i), true);
+  }
+  unsigned int LabeledMarkerCount = bound ? client.GetLabeledMarkerCount().MarkerCount : 0;
+  for (unsigned int MarkerIndex = 0; MarkerIndex < LabeledMarkerCount; ++MarkerIndex) {
+    ViconDataStreamSDK::CPP::Output_GetLabeledMarkerGlobalTranslation OutputTranslation =
+      client.GetLabeledMarkerGlobalTranslation(MarkerIndex);
+    if (OutputTranslation.Result != ViconDataStreamSDK::CPP::Result::Success) {
+      continue;
+    }
+    int slot = labeled_marker_index_.slot(OutputTranslation.MarkerID);
+    if (slot < 0) {
+      // Seen for the first time, bound with the next frame
+      bound = false;
+      LabeledMarkerIndex::read_by_name(client, cloud_markers_);
+      break;
+    }
+    set_marker_point(*cloud_msg, slot, OutputTranslation.Translation, slot, false);
+  }
+  if (!bound) {
+    for (size_t i = 0; i < n_labeled && i < cloud_markers_.size(); i++) {
+      const mocap_msgs::msg::Marker & marker = cloud_markers_[i];
+      const double translation[3] = {
+        marker.translation.x, marker.translation.y, marker.translation.z};
+      set_marker_point(
+        *cloud_msg, i, translation, static_cast<int32_t>(i), static_cast<bool>(marker.occluded));
+    }
+  }
+
+  for (unsigned int MarkerIndex = 0; MarkerIndex < UnlabeledMarkerCount; ++MarkerIndex) {
+    ViconDataStreamSDK::CPP::Output_GetUnlabeledMarkerGlobalTranslation OutputTranslation =
+      client.GetUnlabeledMarkerGlobalTranslation(MarkerIndex);
+    bool success = OutputTranslation.Result == ViconDataStreamSDK::CPP::Result::Success;
+    set_marker_point(
+      *cloud_msg, n_labeled + MarkerIndex,
+      success ? OutputTranslation.Translation : no_translation, -1, !success);
+  }
+  marker_cloud_pub_->publish(std::move(cloud_msg));
+}
+
+// Markers the index could not bind keep the frames on the by-name path, tell it
+void ViconDriverNode::check_labeled_marker_index()
+{
+  size_t unbound = labeled_marker_index_.unbound();
+  if (unbound > 0) {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), steady_clock_, 5000,
+      "%zu labeled markers not bound to an id by position, read by name until the subjects "
+      "change", unbound);
+  }
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  labeled_marker_resolutions_ = labeled_marker_index_.resolutions();
+  unbound_labeled_markers_ = unbound;
+}
+
+// Whether marker is the labeled marker named "subject/marker"
+static bool is_marker(const mocap_msgs::msg::Marker & marker, const std::string & name)
+{
+  size_t subject_size = marker.subject_name.size();
+  return name.size() == subject_size + 1 + marker.marker_name.size() &&
+         name.compare(0, subject_size, marker.subject_name) == 0 && name[subject_size] == '/' &&
+         name.compare(subject_size + 1, std::string::npos, marker.marker_name) == 0;
+}
+
+// Solves the marker clusters from the markers of the frame: the labeled clusters from the
+// labeled markers (before first_unlabeled) by name, the unlabeled ones from
+// unlabeled_positions_ and their track ids. The poses are published by process_subjects.
+void ViconDriverNode::solve_marker_clusters(
+  const std::vector<mocap_msgs::msg::Marker> & markers, size_t first_unlabeled)
+{
+  size_t n_unlabeled = unlabeled_positions_.size() / 3;
+  unsigned int n_solved = 0;
+  for (size_t i = 0; i < marker_clusters_.size(); i++) {
+    MarkerCluster & cluster = marker_clusters_[i];
+    if (!cluster.labeled()) {
+      cluster.solve_unlabeled(
+        unlabeled_positions_.data(), track_unlabeled_markers_ ? unlabeled_ids_.data() : nullptr,
+        n_unlabeled);
+    } else {
+      double positions[MarkerCluster::kMaxMarkers * 3];
+      bool seen[MarkerCluster::kMaxMarkers];
+      std::vector<size_t> & slots = cluster_marker_slots_[i];
+      for (size_t k = 0; k < cluster.size(); k++) {
+        const std::string & name = cluster.marker_names()[k];
+        // The markers keep their position while the subjects do not change
+        if (slots[k] >= first_unlabeled || !is_marker(markers[slots[k]], name)) {
+          slots[k] = first_unlabeled;
+          for (size_t j = 0; j < first_unlabeled; j++) {
+            if (is_marker(markers[j], name)) {
+              slots[k] = j;
+              break;
+            }
+          }
+        }
+        seen[k] = slots[k] < first_unlabeled && !markers[slots[k]].occluded;
+        if (seen[k]) {
+          positions[k * 3] = markers[slots[k]].translation.x;
+          positions[k * 3 + 1] = markers[slots[k]].translation.y;
+          positions[k * 3 + 2] = markers[slots[k]].translation.z;
+        }
+      }
+      cluster.solve_labeled(positions, seen);
+    }
+    if (cluster.solved()) {
+      n_solved++;
+    }
+  }
+
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  solved_cluster_count_ = n_solved;
+  unsolved_cluster_count_ += marker_clusters_.size() - n_solved;
 }
 
 // Transform and publish the information previously procesed by the process_markers and converted in ROS-TFs.
@@ -580,12 +2414,132 @@ ViconDriverNode::on_configure(const rclcpp_lifecycle::State &)
 
   tf_broadcaster_ = std::make_shared<tf2_ros::TransformBroadcaster>(this);
 
+  if (timestamp_mode_ != "latency" && timestamp_mode_ != "hardware_frame") {
+    RCLCPP_WARN(
+      get_logger(), "Unknown timestamp mode %s -- options are latency, hardware_frame. "
+      "Using latency", timestamp_mode_.c_str());
+    timestamp_mode_ = "latency";
+  }
+  clock_estimator_ = FrameClockEstimator(
+    static_cast<size_t>(clock_estimator_window_), clock_outlier_threshold_,
+    clock_max_drift_ppm_);
+
+  TwistEstimator::Method twist_method = TwistEstimator::KALMAN;
+  twist_enabled_ = TwistEstimator::parse_method(twist_estimator_name_, twist_method);
+  if (!twist_enabled_ && twist_estimator_name_ != "none") {
+    RCLCPP_WARN(
+      get_logger(), "Unknown twist estimator %s -- options are kalman, savitzky_golay, none. "
+      "Not estimating the twist", twist_estimator_name_.c_str());
+  }
+  // Bodies not seen for a quarter of a second start again
+  twist_estimator_.configure(
+    twist_method, static_cast<size_t>(max(twist_window_, 3)), twist_process_noise_,
+    pose_variance_, 0.25);
+  pose_jump_filter_.configure(
+    max_linear_velocity_, max_angular_velocity_,
+    static_cast<uint32_t>(max(max_rejected_frames_, 0)));
+  segment_tracks_.clear();
+  marker_tracker_.configure(
+    marker_track_gate_mm_, static_cast<uint32_t>(max(marker_track_max_missed_, 0)));
+  marker_clusters_.clear();
+  cluster_marker_slots_.clear();
+  for (size_t i = 0; i < marker_cluster_names_.size(); i++) {
+    MarkerCluster cluster;
+    std::string error;
+    if (!cluster.configure(
+        marker_cluster_names_[i], marker_cluster_markers_[i], marker_cluster_positions_[i],
+        max_cluster_residual_mm_, error))
+    {
+      RCLCPP_WARN(
+        get_logger(), "Marker cluster %s %s, not solving it", marker_cluster_names_[i].c_str(),
+        error.c_str());
+      continue;
+    }
+    marker_clusters_.push_back(cluster);
+    cluster_marker_slots_.emplace_back(cluster.size(), 0);
+  }
+  solved_cluster_count_ = 0;
+  unsolved_cluster_count_ = 0;
+  if ((publish_predicted_poses_ || evaluate_prediction_) && !twist_enabled_) {
+    RCLCPP_WARN(get_logger(), "The poses are predicted from their twist, set twist_estimator");
+  }
+
+  drop_rate_windows_.erase(
+    std::remove_if(
+      drop_rate_windows_.begin(), drop_rate_windows_.end(),
+      [](double window) {return window <= 0.0;}),
+    drop_rate_windows_.end());
+
+  if (!diag_updater_) {
+    diag_updater_ = std::make_shared<diagnostic_updater::Updater>(this);
+    diag_updater_->add("connection", this, &ViconDriverNode::diagnose_connection);
+    diag_updater_->add("capture", this, &ViconDriverNode::diagnose_capture);
+    diag_updater_->add("frame drops", this, &ViconDriverNode::diagnose_frame_drops);
+    diag_updater_->add("timestamping", this, &ViconDriverNode::diagnose_timestamping);
+    diag_updater_->add("occlusions", this, &ViconDriverNode::diagnose_occlusions);
+    // Always registered, evaluate_prediction may change on the next configure
+    diag_updater_->add("prediction", this, &ViconDriverNode::diagnose_prediction);
+  }
+  diag_updater_->setHardwareID(host_name_);
+
   client_change_state_ = this->create_client<lifecycle_msgs::srv::ChangeState>(
     "/vicon2_driver/change_state");
 
   marker_pub_ = create_publisher<mocap_msgs::msg::Markers>(
     tracked_frame_suffix_ + "/markers", 100);
 
+  marker_rays_pub_ = create_publisher<vicon2_msgs::msg::MarkerRays>(
+    tracked_frame_suffix_ + "/markers/rays", 100);
+
+  marker_cloud_pub_ = create_publisher<sensor_msgs::msg::PointCloud2>(
+    tracked_frame_suffix_ + "/markers/cloud", qos);
+
+  metadata_pub_ = create_publisher<vicon2_msgs::msg::FrameMetadata>(
+    tracked_frame_suffix_ + "/frame_metadata", qos);
+
+  force_plate_pub_ = create_publisher<vicon2_msgs::msg::ForcePlate>(
+    tracked_frame_suffix_ + "/force_plates", qos);
+
+  // The schema is only sent when it changes, late subscribers get the last one. Intra-process
+  // publishers refuse transient_local, so this one always goes through the middleware.
+  device_schema_pub_.reset();
+  if (publish_devices_) {
+    rclcpp::PublisherOptions latched_options;
+    latched_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+    device_schema_pub_ = create_publisher<vicon2_msgs::msg::DeviceSchema>(
+      tracked_frame_suffix_ + "/devices/schema", rclcpp::QoS(1).reliable().transient_local(),
+      latched_options);
+  }
+
+  device_pub_ = create_publisher<vicon2_msgs::msg::DeviceFrame>(
+    tracked_frame_suffix_ + "/devices", qos);
+
+  segment_batch_pub_ = create_publisher<vicon2_msgs::msg::SegmentBatch>(
+    tracked_frame_suffix_ + "/segment_batch", qos);
+
+  predicted_batch_pub_ = create_publisher<vicon2_msgs::msg::SegmentBatch>(
+    tracked_frame_suffix_ + "/segment_batch/predicted", qos);
+
+  // Latched like the device schema, so also kept out of intra-process
+  camera_calibration_pub_.reset();
+  if (publish_camera_calibration_) {
+    rclcpp::PublisherOptions latched_options;
+    latched_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+    camera_calibration_pub_ = create_publisher<vicon2_msgs::msg::CameraCalibrations>(
+      tracked_frame_suffix_ + "/camera_calibration", rclcpp::QoS(1).reliable().transient_local(),
+      latched_options);
+  }
+
+  centroids_pub_ = create_publisher<vicon2_msgs::msg::Centroids>(
+    tracked_frame_suffix_ + "/centroids", qos);
+
+  greyscale_blobs_pub_ = create_publisher<vicon2_msgs::msg::GreyscaleBlobs>(
+    tracked_frame_suffix_ + "/greyscale_blobs", qos);
+
+  // Created by the capture thread with the camera list, one per video camera
+  video_pubs_.clear();
+  camera_list_valid_ = false;
+
   update_pub_ = create_publisher<std_msgs::msg::Empty>(
     "/vicon2_driver/update_notify", qos);
 
@@ -601,13 +2555,48 @@ ViconDriverNode::on_activate(const rclcpp_lifecycle::State &)
   RCLCPP_INFO(get_logger(), "State label [%s]", get_current_state().label().c_str());
   update_pub_->on_activate();
   marker_pub_->on_activate();
+  marker_rays_pub_->on_activate();
+  marker_cloud_pub_->on_activate();
+  metadata_pub_->on_activate();
+  force_plate_pub_->on_activate();
+  if (device_schema_pub_) {
+    device_schema_pub_->on_activate();
+  }
+  device_pub_->on_activate();
+  segment_batch_pub_->on_activate();
+  predicted_batch_pub_->on_activate();
+  if (camera_calibration_pub_) {
+    camera_calibration_pub_->on_activate();
+  }
+  centroids_pub_->on_activate();
+  greyscale_blobs_pub_->on_activate();
+  for (auto & video_pub : video_pubs_) {
+    video_pub.second->on_activate();
+  }
   for(auto& subject_pub : segment_publishers_)
   {
     subject_pub.second.pub->on_activate();
     subject_pub.second.odom_pub->on_activate();
     subject_pub.second.is_ready = true;
   }
-  connect_vicon();
+
+  if (lock_memory_) {
+    std::string error;
+    memory_locked_ = lock_process_memory(error);
+    if (!memory_locked_) {
+      RCLCPP_WARN(get_logger(), "Unable to lock the process memory: %s", error.c_str());
+    }
+    reserve_frame_buffers();
+  }
+
+  if (publish_greyscale_blobs_) {
+    blob_worker_.start();
+  }
+  if (publish_video_) {
+    video_worker_.start();
+  }
+  capture_running_ = true;
+  capture_thread_ = boost::thread(&ViconDriverNode::capture_thread_main, this);
   RCLCPP_INFO(get_logger(), "Activated!\n");
 
   return CallbackReturnT::SUCCESS;
@@ -618,8 +2607,30 @@ ViconDriverNode::on_deactivate(const rclcpp_lifecycle::State &)
 {
   RCLCPP_INFO(get_logger(), "State id [%d]", get_current_state().id());
   RCLCPP_INFO(get_logger(), "State label [%s]", get_current_state().label().c_str());
+  stop_capture_thread();
+  if (client.IsConnected().Connected) {
+    stop_vicon();
+  }
   update_pub_->on_deactivate();
   marker_pub_->on_deactivate();
+  marker_rays_pub_->on_deactivate();
+  marker_cloud_pub_->on_deactivate();
+  metadata_pub_->on_deactivate();
+  force_plate_pub_->on_deactivate();
+  if (device_schema_pub_) {
+    device_schema_pub_->on_deactivate();
+  }
+  device_pub_->on_deactivate();
+  segment_batch_pub_->on_deactivate();
+  predicted_batch_pub_->on_deactivate();
+  if (camera_calibration_pub_) {
+    camera_calibration_pub_->on_deactivate();
+  }
+  centroids_pub_->on_deactivate();
+  greyscale_blobs_pub_->on_deactivate();
+  for (auto & video_pub : video_pubs_) {
+    video_pub.second->on_deactivate();
+  }
   for(auto& subject_pub : segment_publishers_)
   {
     subject_pub.second.pub->on_deactivate();
@@ -648,6 +2659,7 @@ ViconDriverNode::on_shutdown(const rclcpp_lifecycle::State &)
   RCLCPP_INFO(get_logger(), "State id [%d]", get_current_state().id());
   RCLCPP_INFO(get_logger(), "State label [%s]", get_current_state().label().c_str());
   /* Shut down stuff */
+  stop_capture_thread();
   RCLCPP_INFO(get_logger(), "Shutted down!\n");
 
   return CallbackReturnT::SUCCESS;
@@ -665,18 +2677,60 @@ ViconDriverNode::on_error(const rclcpp_lifecycle::State &)
 // In charge of find and connect the driver with the Vicon SDK.
 bool ViconDriverNode::connect_vicon()
 {
+  const std::string & host_name = servers_[active_server_].host_name;
   RCLCPP_WARN(
     get_logger(),
-    "Trying to connect to Vicon DataStream SDK at %s ...", host_name_.c_str());
+    "Trying to connect to Vicon DataStream SDK at %s ...", host_name.c_str());
+
+  // Bound the time Connect() may block, so the capture thread can be stopped
+  client.SetConnectionTimeout(static_cast<unsigned int>(connection_timeout_ms_));
 
-  if (client.Connect(host_name_).Result == ViconDataStreamSDK::CPP::Result::Success) {
+  {
+    boost::mutex::scoped_lock lock(capture_stats_mutex_);
+    connection_attempts_++;
+  }
+
+  if (client.Connect(host_name).Result == ViconDataStreamSDK::CPP::Result::Success) {
     RCLCPP_INFO(get_logger(), "... connected!");
-    start_vicon();
   } else {
     RCLCPP_INFO(get_logger(), "... not connected :( ");
   }
 
-  return client.IsConnected().Connected;
+  connected_ = client.IsConnected().Connected;
+  if (connected_ && reconnecting_) {
+    boost::mutex::scoped_lock lock(capture_stats_mutex_);
+    reconnect_count_++;
+  }
+  return connected_;
+}
+
+void ViconDriverNode::diagnose_connection(diagnostic_updater::DiagnosticStatusWrapper & stat)
+{
+  if (connected_) {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Connected");
+  } else if (capture_running_) {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::ERROR, "Not connected, retrying");
+  } else {
+    stat.summary(diagnostic_msgs::msg::DiagnosticStatus::OK, "Not connected");
+  }
+
+  boost::mutex::scoped_lock lock(capture_stats_mutex_);
+  stat.add("Host", servers_[active_server_].host_name);
+  stat.add("Connection attempts", connection_attempts_);
+  stat.add("Reconnections", reconnect_count_);
+  stat.addf("Last reconnect time (s)", "%.3f", last_reconnect_time_);
+  stat.addf("Max reconnect time (s)", "%.3f", max_reconnect_time_);
+  stat.add("Failovers", failover_count_);
+  stat.addf("Last failover time (s)", "%.3f", last_failover_time_);
+  stat.addf("Max failover time (s)", "%.3f", max_failover_time_);
+  for (size_t i = 0; i < servers_.size(); i++) {
+    const ViconServer & server = servers_[i];
+    bool active = (i == active_server_);
+    stat.addf(
+      "Server " + server.host_name, "%s%lu frames, %lu dropped", active ? "active, " : "",
+      static_cast<unsigned long>(server.frame_gaps.expected()),
+      static_cast<unsigned long>(server.frame_gaps.dropped()));
+  }
 }
 
 // Init the necessary parameters to use the Vicon SDK.
@@ -684,10 +2738,30 @@ void ViconDriverNode::initParameters()
 {
   get_parameter<std::string>("stream_mode", stream_mode_);
   get_parameter<std::string>("host_name", host_name_);
+  get_parameter<std::vector<std::string>>("host_names", host_names_);
+  get_parameter<double>("failover_timeout_periods", failover_timeout_periods_);
   get_parameter<std::string>("tf_ref_frame_id", tf_ref_frame_id_);
   get_parameter<std::string>("tracked_frame_suffix", tracked_frame_suffix_);
   get_parameter<bool>("publish_markers", publish_markers_);
+  get_parameter<bool>("publish_marker_rays", publish_marker_rays_);
+  get_parameter<bool>("labeled_markers_by_index", labeled_markers_by_index_);
+  get_parameter<bool>("publish_marker_cloud", publish_marker_cloud_);
   get_parameter<bool>("publish_subjects", publish_subjects_);
+  get_parameter<bool>("publish_frame_metadata", publish_frame_metadata_);
+  get_parameter<bool>("publish_force_plates", publish_force_plates_);
+  get_parameter<bool>("publish_devices", publish_devices_);
+  get_parameter<bool>("publish_segment_batch", publish_segment_batch_);
+  get_parameter<bool>("publish_eye_trackers", publish_eye_trackers_);
+  get_parameter<std::vector<std::string>>("eye_tracker_segments", eye_tracker_segments_);
+  get_parameter<bool>("publish_camera_calibration", publish_camera_calibration_);
+  get_parameter<double>("camera_calibration_refresh_s", camera_calibration_refresh_s_);
+  get_parameter<bool>("publish_centroids", publish_centroids_);
+  get_parameter<std::vector<int64_t>>("centroid_camera_ids", centroid_camera_ids_);
+  get_parameter<bool>("publish_greyscale_blobs", publish_greyscale_blobs_);
+  get_parameter<std::vector<int64_t>>("greyscale_camera_ids", greyscale_camera_ids_);
+  get_parameter<bool>("publish_video", publish_video_);
+  get_parameter<std::vector<int64_t>>("video_camera_ids", video_camera_ids_);
+  get_parameter<int>("video_qos_depth", video_qos_depth_);
   get_parameter<bool>("marker_data_enabled", marker_data_enabled_);
   get_parameter<bool>("unlabeled_marker_data_enabled", unlabeled_marker_data_enabled_);
   get_parameter<int>("lastFrameNumber", lastFrameNumber_);
@@ -695,9 +2769,55 @@ void ViconDriverNode::initParameters()
   get_parameter<int>("droppedFrameCount", droppedFrameCount_);
   get_parameter<int>("n_markers", n_markers_);
   get_parameter<int>("n_unlabeled_markers", n_unlabeled_markers_);
+  get_parameter<bool>("track_unlabeled_markers", track_unlabeled_markers_);
+  get_parameter<double>("marker_track_gate_mm", marker_track_gate_mm_);
+  get_parameter<int>("marker_track_max_missed", marker_track_max_missed_);
+  get_parameter<std::vector<std::string>>("marker_cluster_names", marker_cluster_names_);
+  // The parameters of every cluster are named after it
+  marker_cluster_markers_.assign(marker_cluster_names_.size(), std::vector<std::string>());
+  marker_cluster_positions_.assign(marker_cluster_names_.size(), std::vector<double>());
+  for (size_t i = 0; i < marker_cluster_names_.size(); i++) {
+    std::string prefix = "marker_clusters." + marker_cluster_names_[i];
+    if (!has_parameter(prefix + ".markers")) {
+      declare_parameter<std::vector<std::string>>(
+        prefix + ".markers", std::vector<std::string>());
+      declare_parameter<std::vector<double>>(prefix + ".positions", std::vector<double>());
+    }
+    get_parameter<std::vector<std::string>>(prefix + ".markers", marker_cluster_markers_[i]);
+    get_parameter<std::vector<double>>(prefix + ".positions", marker_cluster_positions_[i]);
+  }
+  get_parameter<double>("max_cluster_residual_mm", max_cluster_residual_mm_);
   get_parameter<std::string>("qos_history_policy", qos_history_policy_);
   get_parameter<std::string>("qos_reliability_policy", qos_reliability_policy_);
   get_parameter<int>("qos_depth", qos_depth_);
+  get_parameter<int>("subject_worker_threads", subject_worker_threads_);
+  get_parameter<double>("min_object_quality", min_object_quality_);
+  get_parameter<double>("pose_variance", pose_variance_);
+  get_parameter<int>("max_extrapolation_ms", max_extrapolation_ms_);
+  get_parameter<std::string>("twist_estimator", twist_estimator_name_);
+  get_parameter<int>("twist_window", twist_window_);
+  get_parameter<double>("twist_process_noise", twist_process_noise_);
+  get_parameter<bool>("pose_filter", pose_filter_);
+  get_parameter<double>("max_linear_velocity", max_linear_velocity_);
+  get_parameter<double>("max_angular_velocity", max_angular_velocity_);
+  get_parameter<int>("max_rejected_frames", max_rejected_frames_);
+  get_parameter<bool>("publish_predicted_poses", publish_predicted_poses_);
+  get_parameter<double>("prediction_offset_ms", prediction_offset_ms_);
+  get_parameter<bool>("evaluate_prediction", evaluate_prediction_);
+  get_parameter<int>("capture_thread_priority", capture_thread_priority_);
+  get_parameter<std::vector<int64_t>>("capture_thread_cpus", capture_thread_cpus_);
+  get_parameter<bool>("lock_memory", lock_memory_);
+  get_parameter<int>("reserved_frame_items", reserved_frame_items_);
+  get_parameter<int>("connection_timeout_ms", connection_timeout_ms_);
+  get_parameter<int>("reconnect_backoff_initial_ms", reconnect_backoff_initial_ms_);
+  get_parameter<int>("reconnect_backoff_max_ms", reconnect_backoff_max_ms_);
+  get_parameter<std::string>("timestamp_mode", timestamp_mode_);
+  get_parameter<int>("clock_estimator_window", clock_estimator_window_);
+  get_parameter<double>("clock_outlier_threshold", clock_outlier_threshold_);
+  get_parameter<double>("clock_max_drift_ppm", clock_max_drift_ppm_);
+  get_parameter<std::vector<double>>("drop_rate_windows", drop_rate_windows_);
+  get_parameter<double>("drop_budget_pct", drop_budget_pct_);
+  get_parameter<int>("drop_alert_period_ms", drop_alert_period_ms_);
 
 
   RCLCPP_INFO(
@@ -706,6 +2826,25 @@ void ViconDriverNode::initParameters()
   RCLCPP_INFO(
     get_logger(),
     "Param host_name: %s", host_name_.c_str());
+  for (const auto & host_name : host_names_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param host_names: %s", host_name.c_str());
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param failover_timeout_periods: %f", failover_timeout_periods_);
+
+  // Servers in order of preference, host_name alone when no list is given
+  servers_.clear();
+  active_server_ = 0;
+  for (const auto & host_name : host_names_.empty() ?
+    std::vector<std::string>{host_name_} : host_names_)
+  {
+    ViconServer server;
+    server.host_name = host_name;
+    servers_.push_back(server);
+  }
   RCLCPP_INFO(
     get_logger(),
     "Param tf_ref_frame_id: %s", tf_ref_frame_id_.c_str());
@@ -718,6 +2857,68 @@ void ViconDriverNode::initParameters()
   RCLCPP_INFO(
     get_logger(),
     "Param publish_subjects: %s", publish_subjects_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_marker_rays: %s", publish_marker_rays_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param labeled_markers_by_index: %s", labeled_markers_by_index_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_marker_cloud: %s", publish_marker_cloud_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_frame_metadata: %s", publish_frame_metadata_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_force_plates: %s", publish_force_plates_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_devices: %s", publish_devices_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_segment_batch: %s", publish_segment_batch_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_eye_trackers: %s", publish_eye_trackers_ ? "true" : "false");
+  for (const auto & segment : eye_tracker_segments_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param eye_tracker_segments: %s", segment.c_str());
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_camera_calibration: %s", publish_camera_calibration_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param camera_calibration_refresh_s: %f", camera_calibration_refresh_s_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_centroids: %s", publish_centroids_ ? "true" : "false");
+  for (const auto & camera_id : centroid_camera_ids_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param centroid_camera_ids: %ld", static_cast<long>(camera_id));
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_greyscale_blobs: %s", publish_greyscale_blobs_ ? "true" : "false");
+  for (const auto & camera_id : greyscale_camera_ids_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param greyscale_camera_ids: %ld", static_cast<long>(camera_id));
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_video: %s", publish_video_ ? "true" : "false");
+  for (const auto & camera_id : video_camera_ids_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param video_camera_ids: %ld", static_cast<long>(camera_id));
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param video_qos_depth: %d", video_qos_depth_);
   RCLCPP_INFO(
     get_logger(),
     "Param marker_data_enabled: %s", marker_data_enabled_ ? "true" : "false");
@@ -739,6 +2940,25 @@ void ViconDriverNode::initParameters()
   RCLCPP_INFO(
     get_logger(),
     "Param n_unlabeled_markers: %d", n_unlabeled_markers_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param track_unlabeled_markers: %s", track_unlabeled_markers_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param marker_track_gate_mm: %f", marker_track_gate_mm_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param marker_track_max_missed: %d", marker_track_max_missed_);
+  for (size_t i = 0; i < marker_cluster_names_.size(); i++) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param marker_cluster_names: %s (%zu markers, %zu positions)",
+      marker_cluster_names_[i].c_str(), marker_cluster_markers_[i].size(),
+      marker_cluster_positions_[i].size() / 3);
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param max_cluster_residual_mm: %f", max_cluster_residual_mm_);
   RCLCPP_INFO(
     get_logger(),
     "Param qos_history_policy: %s", qos_history_policy_.c_str());
@@ -748,4 +2968,99 @@ void ViconDriverNode::initParameters()
   RCLCPP_INFO(
     get_logger(),
     "Param qos_depth: %d", qos_depth_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param subject_worker_threads: %d", subject_worker_threads_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param min_object_quality: %f", min_object_quality_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param pose_variance: %f", pose_variance_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param max_extrapolation_ms: %d", max_extrapolation_ms_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param twist_estimator: %s", twist_estimator_name_.c_str());
+  RCLCPP_INFO(
+    get_logger(),
+    "Param twist_window: %d", twist_window_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param twist_process_noise: %f", twist_process_noise_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param pose_filter: %s", pose_filter_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param max_linear_velocity: %f", max_linear_velocity_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param max_angular_velocity: %f", max_angular_velocity_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param max_rejected_frames: %d", max_rejected_frames_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param publish_predicted_poses: %s", publish_predicted_poses_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param prediction_offset_ms: %f", prediction_offset_ms_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param evaluate_prediction: %s", evaluate_prediction_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param capture_thread_priority: %d", capture_thread_priority_);
+  for (const auto & cpu : capture_thread_cpus_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param capture_thread_cpus: %ld", static_cast<long>(cpu));
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param lock_memory: %s", lock_memory_ ? "true" : "false");
+  RCLCPP_INFO(
+    get_logger(),
+    "Param reserved_frame_items: %d", reserved_frame_items_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param connection_timeout_ms: %d", connection_timeout_ms_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param reconnect_backoff_initial_ms: %d", reconnect_backoff_initial_ms_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param reconnect_backoff_max_ms: %d", reconnect_backoff_max_ms_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param timestamp_mode: %s", timestamp_mode_.c_str());
+  RCLCPP_INFO(
+    get_logger(),
+    "Param clock_estimator_window: %d", clock_estimator_window_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param clock_outlier_threshold: %f", clock_outlier_threshold_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param clock_max_drift_ppm: %f", clock_max_drift_ppm_);
+  for (const auto & window : drop_rate_windows_) {
+    RCLCPP_INFO(
+      get_logger(),
+      "Param drop_rate_windows: %f", window);
+  }
+  RCLCPP_INFO(
+    get_logger(),
+    "Param drop_budget_pct: %f", drop_budget_pct_);
+  RCLCPP_INFO(
+    get_logger(),
+    "Param drop_alert_period_ms: %d", drop_alert_period_ms_);
 }
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(ViconDriverNode)
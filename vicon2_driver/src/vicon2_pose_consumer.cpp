@@ -0,0 +1,53 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <memory>
+
+#include "vicon2_driver/vicon2_pose_consumer.hpp"
+
+using std::placeholders::_1;
+
+ViconPoseConsumer::ViconPoseConsumer(const rclcpp::NodeOptions & options)
+: rclcpp::Node("vicon2_pose_consumer", options),
+  msg_count_(0)
+{
+  declare_parameter<std::string>("odom_topic", "vicon/robot/robot_odom");
+  get_parameter<std::string>("odom_topic", odom_topic_);
+
+  odom_sub_ = create_subscription<nav_msgs::msg::Odometry>(
+    odom_topic_, rclcpp::SensorDataQoS(),
+    std::bind(&ViconPoseConsumer::odom_callback, this, _1));
+
+  RCLCPP_INFO(
+    get_logger(), "Listening to %s (intra-process: %s)", odom_topic_.c_str(),
+    options.use_intra_process_comms() ? "true" : "false");
+}
+
+// The address printed here matches the one of the message created by the driver
+// when both nodes share a container with intra-process communication enabled.
+void ViconPoseConsumer::odom_callback(nav_msgs::msg::Odometry::UniquePtr msg)
+{
+  msg_count_++;
+  RCLCPP_INFO_THROTTLE(
+    get_logger(), *get_clock(), 1000,
+    "[%s] %u poses received, last (%.3f, %.3f, %.3f) at address %p",
+    msg->child_frame_id.c_str(), msg_count_,
+    msg->pose.pose.position.x, msg->pose.pose.position.y, msg->pose.pose.position.z,
+    reinterpret_cast<void *>(msg.get()));
+}
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(ViconPoseConsumer)
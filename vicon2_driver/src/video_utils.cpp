@@ -0,0 +1,81 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+
+#include "vicon2_driver/video_utils.hpp"
+
+using VideoFrame = ViconDataStreamSDK::CPP::Output_GetVideoFrame;
+
+std::string video_format_encoding(unsigned int format)
+{
+  switch (format) {
+    case VideoFrame::EMono8:
+      return "mono8";
+    case VideoFrame::EBayerRG8:
+      return "bayer_rggb8";
+    case VideoFrame::EBayerGB8:
+      return "bayer_gbrg8";
+    case VideoFrame::EBayerGR8:
+      return "bayer_grbg8";
+    case VideoFrame::EBayerBG8:
+      return "bayer_bggr8";
+    case VideoFrame::ERGB888:
+      return "rgb8";
+    case VideoFrame::EBGR888:
+      return "bgr8";
+    default:
+      return "";
+  }
+}
+
+unsigned int video_format_pixel_size(unsigned int format)
+{
+  switch (format) {
+    case VideoFrame::EMono8:
+    case VideoFrame::EBayerRG8:
+    case VideoFrame::EBayerGB8:
+    case VideoFrame::EBayerGR8:
+    case VideoFrame::EBayerBG8:
+      return 1;
+    case VideoFrame::ERGB888:
+    case VideoFrame::EBGR888:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+bool fill_image(const VideoFrame & frame, sensor_msgs::msg::Image & image)
+{
+  unsigned int pixel_size = video_format_pixel_size(frame.m_Format);
+  if (pixel_size == 0 || !frame.m_Data) {
+    return false;
+  }
+  size_t step = static_cast<size_t>(frame.m_Width) * pixel_size;
+  size_t size = step * frame.m_Height;
+  if (frame.m_Data->size() < size) {
+    return false;
+  }
+
+  image.width = frame.m_Width;
+  image.height = frame.m_Height;
+  image.encoding = video_format_encoding(frame.m_Format);
+  image.is_bigendian = false;
+  image.step = static_cast<uint32_t>(step);
+  image.data.resize(size);
+  std::copy(frame.m_Data->begin(), frame.m_Data->begin() + size, image.data.begin());
+  return true;
+}
@@ -0,0 +1,119 @@
+// Copyright 2019 Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <vector>
+
+#include "vicon2_driver/worker_pool.hpp"
+
+WorkerPool::WorkerPool()
+: running_(false),
+  generation_(0),
+  busy_threads_(0),
+  process_(nullptr),
+  n_items_(0),
+  next_item_(0),
+  n_threads_(0),
+  initialized_threads_(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+  stop();
+}
+
+void WorkerPool::start(size_t n_threads, const std::function<bool()> & thread_init)
+{
+  stop();
+  running_ = true;
+  for (size_t i = 0; i < n_threads; i++) {
+    threads_.emplace_back(&WorkerPool::thread_main, this, generation_, thread_init);
+  }
+  n_threads_ = n_threads;
+}
+
+void WorkerPool::stop()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    running_ = false;
+  }
+  start_cond_.notify_all();
+  for (auto & thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  n_threads_ = 0;
+  initialized_threads_ = 0;
+}
+
+void WorkerPool::run(size_t n_items, const std::function<void(size_t)> & process)
+{
+  if (threads_.empty()) {
+    for (size_t i = 0; i < n_items; i++) {
+      process(i);
+    }
+    return;
+  }
+
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    process_ = &process;
+    n_items_ = n_items;
+    next_item_ = 0;
+    busy_threads_ = threads_.size();
+    generation_++;
+  }
+  start_cond_.notify_all();
+
+  work();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  while (busy_threads_ > 0) {
+    done_cond_.wait(lock);
+  }
+  process_ = nullptr;
+}
+
+void WorkerPool::thread_main(uint64_t generation, std::function<bool()> thread_init)
+{
+  if (!thread_init || thread_init()) {
+    initialized_threads_++;
+  }
+
+  boost::mutex::scoped_lock lock(mutex_);
+  while (true) {
+    while (running_ && generation_ == generation) {
+      start_cond_.wait(lock);
+    }
+    if (!running_) {
+      return;
+    }
+    generation = generation_;
+    lock.unlock();
+    work();
+    lock.lock();
+    if (--busy_threads_ == 0) {
+      done_cond_.notify_one();
+    }
+  }
+}
+
+void WorkerPool::work()
+{
+  for (size_t i = next_item_++; i < n_items_; i = next_item_++) {
+    (*process_)(i);
+  }
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Time to solve marker clusters per frame: tracked by id, and searched again among many
+// unlabeled markers when lost.
+//
+// Usage: benchmark_marker_cluster [markers per cluster] [unlabeled markers] [frames]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "vicon2_driver/marker_cluster.hpp"
+
+int main(int argc, char * argv[])
+{
+  size_t n_cluster = argc > 1 ? std::atoi(argv[1]) : 5;
+  size_t n_others = argc > 2 ? std::atoi(argv[2]) : 500;
+  unsigned int frames = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> body(-100.0, 100.0), volume(-3000.0, 3000.0);
+  std::normal_distribution<double> noise(0.0, 0.3);
+  std::vector<double> model(n_cluster * 3);
+  for (double & value : model) {
+    value = body(generator);
+  }
+  std::vector<double> positions;
+  for (size_t i = 0; i < n_others * 3; i++) {
+    positions.push_back(volume(generator));
+  }
+  // The cluster moving along x, after the other markers
+  size_t first = positions.size();
+  positions.resize(first + model.size());
+  std::vector<uint32_t> ids(positions.size() / 3);
+  for (size_t j = 0; j < ids.size(); j++) {
+    ids[j] = static_cast<uint32_t>(j);
+  }
+
+  MarkerCluster cluster;
+  std::string error;
+  if (!cluster.configure("cluster", {}, model, 5.0, error)) {
+    std::printf("%s\n", error.c_str());
+    return 1;
+  }
+
+  double tracked_time = 0.0, acquire_time = 0.0;
+  unsigned int failures = 0;
+  for (unsigned int frame = 0; frame < frames; frame++) {
+    for (size_t i = 0; i < model.size(); i++) {
+      positions[first + i] = model[i] + (i % 3 == 0 ? frame * 5.0 : 0.0) + noise(generator);
+    }
+    size_t n = positions.size() / 3;
+
+    auto begin = std::chrono::steady_clock::now();
+    failures += !cluster.solve_unlabeled(positions.data(), ids.data(), n);
+    tracked_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    MarkerCluster lost = cluster;
+    lost.reset();
+    begin = std::chrono::steady_clock::now();
+    failures += !lost.solve_unlabeled(positions.data(), ids.data(), n);
+    acquire_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  }
+
+  std::printf(
+    "%zu markers per cluster, %zu unlabeled markers, %u frames\n", n_cluster, n_others, frames);
+  std::printf(
+    "tracked: %.2f us/frame, lost: %.1f us/frame, %u failures\n", 1e6 * tracked_time / frames,
+    1e6 * acquire_time / frames, failures);
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Time to track the unlabeled markers of a frame, with markers spread over a capture volume and
+// moving at up to 2 m/s, given in a different order every frame.
+//
+// Usage: benchmark_marker_tracker [markers] [frames] [rate_hz]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "vicon2_driver/marker_tracker.hpp"
+
+int main(int argc, char * argv[])
+{
+  size_t n_markers = argc > 1 ? std::atoi(argv[1]) : 500;
+  unsigned int frames = argc > 2 ? std::atoi(argv[2]) : 2000;
+  double rate = argc > 3 ? std::atof(argv[3]) : 200.0;
+
+  // 6 x 6 x 2 m volume, in mm as the SDK gives them
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> xy(-3000.0, 3000.0), z(0.0, 2000.0);
+  std::uniform_real_distribution<double> speed(-1150.0, 1150.0);
+  std::normal_distribution<double> noise(0.0, 0.3);
+  std::vector<double> start(n_markers * 3), velocity(n_markers * 3);
+  for (size_t marker = 0; marker < n_markers; marker++) {
+    start[marker * 3] = xy(generator);
+    start[marker * 3 + 1] = xy(generator);
+    start[marker * 3 + 2] = z(generator);
+    for (int i = 0; i < 3; i++) {
+      velocity[marker * 3 + i] = speed(generator);
+    }
+  }
+
+  MarkerTracker tracker;
+  tracker.configure(20.0, 5);
+  std::vector<size_t> order(n_markers);
+  for (size_t i = 0; i < n_markers; i++) {
+    order[i] = i;
+  }
+  std::vector<double> positions(n_markers * 3);
+  std::vector<uint32_t> ids, marker_ids(n_markers);
+  double time = 0.0, max_time = 0.0;
+  unsigned int switches = 0;
+
+  for (unsigned int frame = 0; frame < frames; frame++) {
+    double t = frame / rate;
+    std::shuffle(order.begin(), order.end(), generator);
+    for (size_t i = 0; i < n_markers; i++) {
+      for (int k = 0; k < 3; k++) {
+        positions[i * 3 + k] =
+          start[order[i] * 3 + k] + velocity[order[i] * 3 + k] * t + noise(generator);
+      }
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    tracker.update(t, positions.data(), n_markers, ids);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    time += elapsed;
+    max_time = std::max(max_time, elapsed);
+
+    for (size_t i = 0; i < n_markers; i++) {
+      if (frame > 0 && marker_ids[order[i]] != ids[i]) {
+        switches++;
+      }
+      marker_ids[order[i]] = ids[i];
+    }
+  }
+
+  std::printf("%zu markers, %u frames at %.0f Hz\n", n_markers, frames, rate);
+  std::printf(
+    "%.1f us/frame, max %.1f us (budget %.0f us), %u id changes\n", 1e6 * time / frames,
+    1e6 * max_time, 1e6 / rate, switches);
+  return 0;
+}
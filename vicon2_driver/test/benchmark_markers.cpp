@@ -0,0 +1,64 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Time to read the labeled markers of a frame by name and by index, with a fake client that
+// looks names up as the SDK does.
+//
+// Usage: benchmark_markers [subjects] [markers_per_subject] [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "vicon2_driver/labeled_marker_index.hpp"
+#include "fake_marker_client.hpp"
+
+int main(int argc, char * argv[])
+{
+  size_t n_subjects = argc > 1 ? std::atoi(argv[1]) : 10;
+  size_t n_markers = argc > 2 ? std::atoi(argv[2]) : 32;
+  unsigned int frames = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+  FakeMarkerClient client(n_subjects, n_markers);
+  LabeledMarkerIndex index;
+  std::vector<mocap_msgs::msg::Marker> markers;
+  markers.reserve(n_subjects * n_markers);
+  double by_name_time = 0.0, by_index_time = 0.0;
+
+  for (unsigned int frame = 0; frame < frames; frame++) {
+    client.move(frame);
+
+    auto start = std::chrono::steady_clock::now();
+    markers.clear();
+    LabeledMarkerIndex::read_by_name(client, markers);
+    by_name_time += std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    markers.clear();
+    index.read(client, markers);
+    by_index_time += std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::printf(
+    "%zu labeled markers (%zu subjects), %u frames\n", n_subjects * n_markers, n_subjects,
+    frames);
+  std::printf("by name:  %.2f us/frame\n", 1e6 * by_name_time / frames);
+  std::printf(
+    "by index: %.2f us/frame (%lu resolutions)\n", 1e6 * by_index_time / frames,
+    static_cast<unsigned long>(index.resolutions()));
+  return 0;
+}
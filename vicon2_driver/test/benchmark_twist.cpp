@@ -0,0 +1,72 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Time to estimate the twist of many bodies per frame, with both methods.
+//
+// Usage: benchmark_twist [bodies] [frames] [window]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "vicon2_driver/twist_estimator.hpp"
+
+double run(TwistEstimator::Method method, size_t n_bodies, unsigned int frames, size_t window)
+{
+  TwistEstimator estimator;
+  estimator.configure(method, window, 50.0, 1e-6, 0.25);
+  for (size_t body = 0; body < n_bodies; body++) {
+    estimator.add_body();
+  }
+
+  double time = 0.0;
+  double position[3], orientation[4];
+  for (unsigned int frame = 0; frame < frames; frame++) {
+    double t = frame / 100.0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t body = 0; body < n_bodies; body++) {
+      double phase = t + body;
+      position[0] = std::cos(phase);
+      position[1] = std::sin(phase);
+      position[2] = 0.01 * body;
+      orientation[0] = 0.0;
+      orientation[1] = 0.0;
+      orientation[2] = std::sin(phase / 2.0);
+      orientation[3] = std::cos(phase / 2.0);
+      estimator.set_pose(body, position, orientation);
+    }
+    estimator.update(t);
+    time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return time;
+}
+
+int main(int argc, char * argv[])
+{
+  size_t n_bodies = argc > 1 ? std::atoi(argv[1]) : 100;
+  unsigned int frames = argc > 2 ? std::atoi(argv[2]) : 2000;
+  size_t window = argc > 3 ? std::atoi(argv[3]) : 7;
+
+  std::printf("%zu bodies, %u frames\n", n_bodies, frames);
+  double time = run(TwistEstimator::KALMAN, n_bodies, frames, window);
+  std::printf(
+    "kalman:         %.2f us/frame, %.1f ns/body\n", 1e6 * time / frames,
+    1e9 * time / frames / n_bodies);
+  time = run(TwistEstimator::SAVITZKY_GOLAY, n_bodies, frames, window);
+  std::printf(
+    "savitzky_golay: %.2f us/frame, %.1f ns/body (window %zu)\n", 1e6 * time / frames,
+    1e9 * time / frames / n_bodies, window);
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Throughput of the video path with a fake backend in place of the Vicon client: the capture
+// side posts frames at the given rate to a LatestJobWorker, which copies them into images as
+// the driver does. Reports the frames converted and dropped and the conversion bandwidth.
+//
+// Usage: benchmark_video [width] [height] [rate_hz] [seconds]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "vicon2_driver/latest_job_worker.hpp"
+#include "vicon2_driver/video_utils.hpp"
+
+using VideoFrame = ViconDataStreamSDK::CPP::Output_GetVideoFrame;
+
+// Stands for Client::GetVideoFrame: hands out frames from a pool of shared buffers
+class FakeVideoBackend
+{
+public:
+  FakeVideoBackend(unsigned short width, unsigned short height)
+  : width_(width), height_(height), frame_id_(0)
+  {
+    for (int i = 0; i < 4; i++) {
+      pool_.push_back(
+        std::make_shared<std::vector<unsigned char>>(
+          static_cast<size_t>(width) * height * 3, static_cast<unsigned char>(i)));
+    }
+  }
+
+  VideoFrame get_video_frame()
+  {
+    VideoFrame frame;
+    frame.Result = ViconDataStreamSDK::CPP::Result::Success;
+    frame.m_FrameID = frame_id_++;
+    frame.m_Width = width_;
+    frame.m_Height = height_;
+    frame.m_Format = VideoFrame::ERGB888;
+    frame.m_OffsetX = 0;
+    frame.m_OffsetY = 0;
+    frame.m_Data = pool_[frame.m_FrameID % pool_.size()];
+    return frame;
+  }
+
+private:
+  unsigned short width_;
+  unsigned short height_;
+  unsigned int frame_id_;
+  std::vector<std::shared_ptr<std::vector<unsigned char>>> pool_;
+};
+
+int main(int argc, char * argv[])
+{
+  unsigned short width = argc > 1 ? static_cast<unsigned short>(std::atoi(argv[1])) : 1920;
+  unsigned short height = argc > 2 ? static_cast<unsigned short>(std::atoi(argv[2])) : 1080;
+  double rate = argc > 3 ? std::atof(argv[3]) : 250.0;
+  double seconds = argc > 4 ? std::atof(argv[4]) : 5.0;
+
+  FakeVideoBackend backend(width, height);
+  double convert_time = 0.0;
+  size_t bytes = 0;
+  LatestJobWorker<VideoFrame> worker(
+    [&](VideoFrame & frame) {
+      auto start = std::chrono::steady_clock::now();
+      // A new image per frame, as with a middleware that can not loan sensor_msgs/Image
+      auto image = std::make_unique<sensor_msgs::msg::Image>();
+      if (fill_image(frame, *image)) {
+        bytes += image->data.size();
+      }
+      convert_time += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    });
+  worker.start();
+
+  auto period = std::chrono::duration<double>(1.0 / rate);
+  auto start = std::chrono::steady_clock::now();
+  auto next = start;
+  size_t posted = 0;
+  while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(seconds)) {
+    worker.post(std::make_unique<VideoFrame>(backend.get_video_frame()));
+    posted++;
+    next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+    while (std::chrono::steady_clock::now() < next) {
+    }
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  worker.stop();
+
+  unsigned long processed = static_cast<unsigned long>(worker.processed());
+  std::printf("%ux%u RGB at %.0f Hz for %.1f s\n", width, height, rate, elapsed);
+  std::printf(
+    "posted %zu, converted %lu (%.1f fps), dropped %lu\n", posted, processed,
+    processed / elapsed, static_cast<unsigned long>(worker.dropped()));
+  if (processed > 0) {
+    std::printf(
+      "conversion %.3f ms/frame, %.1f MB/s\n", 1e3 * convert_time / processed,
+      bytes / convert_time / 1e6);
+  }
+  return 0;
+}
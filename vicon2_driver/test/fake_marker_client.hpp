@@ -0,0 +1,190 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FAKE_MARKER_CLIENT_HPP_
+#define FAKE_MARKER_CLIENT_HPP_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DataStreamClient.h"
+
+// Stands for the marker calls of ViconDataStreamSDK::CPP::Client. Names are looked up by a
+// linear search, as the SDK does, and the labeled markers are listed in reverse order, so
+// nothing can rely on both lists having the same order.
+class FakeMarkerClient
+{
+public:
+  struct Marker
+  {
+    std::string name;
+    std::string parent;
+    unsigned int id;
+    double translation[3];
+    bool occluded;
+  };
+
+  struct Subject
+  {
+    std::string name;
+    std::vector<Marker> markers;
+  };
+
+  std::vector<Subject> subjects;
+  // Added to the positions of the labeled list, which may not be the same doubles as by name
+  double labeled_offset;
+
+  FakeMarkerClient(size_t n_subjects, size_t n_markers)
+  : labeled_offset(0.0)
+  {
+    unsigned int id = 0;
+    for (size_t s = 0; s < n_subjects; s++) {
+      Subject subject;
+      subject.name = "subject_" + std::to_string(s);
+      for (size_t m = 0; m < n_markers; m++) {
+        Marker marker;
+        marker.name = "marker_" + std::to_string(m);
+        marker.parent = "segment_" + std::to_string(m % 4);
+        marker.id = id++;
+        marker.occluded = false;
+        subject.markers.push_back(marker);
+      }
+      subjects.push_back(subject);
+    }
+    move(0);
+  }
+
+  // Moves every marker to a position depending on the frame, and updates the labeled list
+  void move(unsigned int frame)
+  {
+    labeled_.clear();
+    for (size_t s = 0; s < subjects.size(); s++) {
+      for (size_t m = 0; m < subjects[s].markers.size(); m++) {
+        Marker & marker = subjects[s].markers[m];
+        marker.translation[0] = marker.occluded ? 0.0 : 1000.0 * s + m + 0.001 * frame;
+        marker.translation[1] = marker.occluded ? 0.0 : 10.0 * m;
+        marker.translation[2] = marker.occluded ? 0.0 : 0.5 * frame;
+        if (!marker.occluded) {
+          labeled_.insert(labeled_.begin(), std::make_pair(s, m));
+        }
+      }
+    }
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetSubjectCount GetSubjectCount() const
+  {
+    ViconDataStreamSDK::CPP::Output_GetSubjectCount output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    output.SubjectCount = static_cast<unsigned int>(subjects.size());
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetSubjectName GetSubjectName(unsigned int index) const
+  {
+    ViconDataStreamSDK::CPP::Output_GetSubjectName output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    output.SubjectName = subjects[index].name;
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetMarkerCount GetMarkerCount(
+    const std::string & subject_name) const
+  {
+    ViconDataStreamSDK::CPP::Output_GetMarkerCount output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    output.MarkerCount = static_cast<unsigned int>(find_subject(subject_name).markers.size());
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetMarkerName GetMarkerName(
+    const std::string & subject_name, unsigned int index) const
+  {
+    ViconDataStreamSDK::CPP::Output_GetMarkerName output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    output.MarkerName = find_subject(subject_name).markers[index].name;
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetMarkerParentName GetMarkerParentName(
+    const std::string & subject_name, const std::string & marker_name) const
+  {
+    ViconDataStreamSDK::CPP::Output_GetMarkerParentName output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    output.SegmentName = find_marker(subject_name, marker_name).parent;
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetMarkerGlobalTranslation GetMarkerGlobalTranslation(
+    const std::string & subject_name, const std::string & marker_name) const
+  {
+    const Marker & marker = find_marker(subject_name, marker_name);
+    ViconDataStreamSDK::CPP::Output_GetMarkerGlobalTranslation output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    for (int i = 0; i < 3; i++) {
+      output.Translation[i] = marker.translation[i];
+    }
+    output.Occluded = marker.occluded;
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetLabeledMarkerCount GetLabeledMarkerCount() const
+  {
+    ViconDataStreamSDK::CPP::Output_GetLabeledMarkerCount output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    output.MarkerCount = static_cast<unsigned int>(labeled_.size());
+    return output;
+  }
+
+  ViconDataStreamSDK::CPP::Output_GetLabeledMarkerGlobalTranslation
+  GetLabeledMarkerGlobalTranslation(unsigned int index) const
+  {
+    const Marker & marker = subjects[labeled_[index].first].markers[labeled_[index].second];
+    ViconDataStreamSDK::CPP::Output_GetLabeledMarkerGlobalTranslation output;
+    output.Result = ViconDataStreamSDK::CPP::Result::Success;
+    for (int i = 0; i < 3; i++) {
+      output.Translation[i] = marker.translation[i] + labeled_offset;
+    }
+    output.MarkerID = marker.id;
+    return output;
+  }
+
+private:
+  const Subject & find_subject(const std::string & subject_name) const
+  {
+    for (const auto & subject : subjects) {
+      if (subject.name == subject_name) {
+        return subject;
+      }
+    }
+    return subjects.front();
+  }
+
+  const Marker & find_marker(const std::string & subject_name, const std::string & marker_name)
+  const
+  {
+    const Subject & subject = find_subject(subject_name);
+    for (const auto & marker : subject.markers) {
+      if (marker.name == marker_name) {
+        return marker;
+      }
+    }
+    return subject.markers.front();
+  }
+
+  // (subject, marker) of the visible markers
+  std::vector<std::pair<size_t, size_t>> labeled_;
+};
+
+#endif  // FAKE_MARKER_CLIENT_HPP_
@@ -0,0 +1,87 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/frame_clock_estimator.hpp"
+
+static const int64_t kStart = 1600000000LL * 1000000000LL;
+
+TEST(FrameClockEstimatorTest, test_jitter_removed)
+{
+  const double rate = 200.0;
+  const double drift = 50e-6;
+  FrameClockEstimator estimator(500, 4.0, 1000.0);
+  estimator.set_nominal_rate(rate);
+
+  std::mt19937 gen(42);
+  std::normal_distribution<double> jitter(0.0, 300e-6);
+
+  for (uint64_t frame = 1000; frame < 3000; frame++) {
+    double t = (frame - 1000) * (1.0 + drift) / rate;
+    estimator.add_sample(frame, kStart + static_cast<int64_t>((t + jitter(gen)) * 1e9));
+  }
+
+  ASSERT_TRUE(estimator.is_valid());
+  EXPECT_NEAR(estimator.drift_ppm(), 50.0, 30.0);
+
+  // Consecutive stamps are evenly spaced and close to the true time
+  int64_t s0 = estimator.stamp(2998);
+  int64_t s1 = estimator.stamp(2999);
+  EXPECT_NEAR((s1 - s0) * 1e-9, (1.0 + drift) / rate, 1e-7);
+  double t_true = (2999 - 1000) * (1.0 + drift) / rate;
+  EXPECT_NEAR((s1 - kStart) * 1e-9, t_true, 100e-6);
+  EXPECT_NEAR(estimator.rms_residual(), 300e-6, 60e-6);
+}
+
+TEST(FrameClockEstimatorTest, test_outliers_rejected)
+{
+  FrameClockEstimator estimator(200, 4.0, 1000.0);
+  estimator.set_nominal_rate(100.0);
+
+  for (uint64_t frame = 0; frame < 100; frame++) {
+    EXPECT_TRUE(estimator.add_sample(frame, kStart + static_cast<int64_t>(frame * 1e7)));
+  }
+  // A frame delivered 20 ms late does not move the fit
+  EXPECT_FALSE(estimator.add_sample(100, kStart + static_cast<int64_t>(100 * 1e7 + 2e7)));
+  EXPECT_EQ(estimator.rejected_count(), 1u);
+  EXPECT_NEAR(estimator.stamp(100) - kStart, 100 * 1e7, 1e3);
+}
+
+TEST(FrameClockEstimatorTest, test_frame_reset)
+{
+  FrameClockEstimator estimator(200, 4.0, 1000.0);
+  estimator.set_nominal_rate(100.0);
+
+  for (uint64_t frame = 500; frame < 600; frame++) {
+    estimator.add_sample(frame, kStart + static_cast<int64_t>(frame * 1e7));
+  }
+  ASSERT_TRUE(estimator.is_valid());
+
+  // Server restarted: frame numbers start again from 0
+  estimator.add_sample(0, kStart + static_cast<int64_t>(700 * 1e7));
+  EXPECT_EQ(estimator.reset_count(), 1u);
+  EXPECT_EQ(estimator.sample_count(), 1u);
+  EXPECT_FALSE(estimator.is_valid());
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/frame_gap_tracker.hpp"
+
+TEST(FrameGapTrackerTest, test_gaps)
+{
+  FrameGapTracker tracker;
+  tracker.set_window_sizes(std::vector<size_t>{4, 100});
+
+  EXPECT_EQ(tracker.update(10), FrameGapTracker::FIRST);
+  EXPECT_EQ(tracker.update(11), FrameGapTracker::NEXT);
+  EXPECT_EQ(tracker.update(11), FrameGapTracker::DUPLICATE);
+  EXPECT_EQ(tracker.update(14), FrameGapTracker::GAP);
+  EXPECT_EQ(tracker.last_dropped(), 2u);
+  EXPECT_EQ(tracker.update(15), FrameGapTracker::NEXT);
+
+  EXPECT_EQ(tracker.received(), 4u);
+  EXPECT_EQ(tracker.expected(), 6u);
+  EXPECT_EQ(tracker.dropped(), 2u);
+  EXPECT_EQ(tracker.gaps(), 1u);
+  EXPECT_EQ(tracker.duplicates(), 1u);
+  EXPECT_NEAR(tracker.drop_pct(), 100.0 * 2 / 6, 1e-9);
+  EXPECT_EQ(tracker.gap_histogram()[1], 1u);
+
+  // The short window forgets the gap after four more frames
+  EXPECT_TRUE(tracker.window_full(0));
+  for (uint32_t frame = 16; frame < 20; frame++) {
+    tracker.update(frame);
+  }
+  EXPECT_DOUBLE_EQ(tracker.window_drop_pct(0), 0.0);
+  EXPECT_FALSE(tracker.window_full(1));
+  EXPECT_NEAR(tracker.window_drop_pct(1), 100.0 * 2 / 10, 1e-9);
+}
+
+TEST(FrameGapTrackerTest, test_resets)
+{
+  FrameGapTracker tracker(1000);
+
+  tracker.update(5000);
+  EXPECT_EQ(tracker.update(3), FrameGapTracker::RESET);
+  EXPECT_EQ(tracker.update(100000), FrameGapTracker::RESET);
+  EXPECT_EQ(tracker.resets(), 2u);
+  EXPECT_EQ(tracker.dropped(), 0u);
+
+  // After a reconnection the jump is not counted as dropped frames
+  tracker.break_continuity();
+  EXPECT_EQ(tracker.update(100500), FrameGapTracker::FIRST);
+  EXPECT_EQ(tracker.dropped(), 0u);
+}
+
+TEST(FrameGapTrackerTest, test_histogram_labels)
+{
+  EXPECT_EQ(FrameGapTracker::histogram_label(0), "1");
+  EXPECT_EQ(FrameGapTracker::histogram_label(2), "3-4");
+  EXPECT_EQ(FrameGapTracker::histogram_label(6), "33-64");
+  EXPECT_EQ(FrameGapTracker::histogram_label(7), ">64");
+
+  FrameGapTracker tracker;
+  tracker.update(0);
+  tracker.update(66);
+  EXPECT_EQ(tracker.gap_histogram()[7], 1u);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
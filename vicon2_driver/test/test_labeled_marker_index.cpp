@@ -0,0 +1,183 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/labeled_marker_index.hpp"
+#include "fake_marker_client.hpp"
+
+void expect_same_markers(
+  const std::vector<mocap_msgs::msg::Marker> & markers,
+  const std::vector<mocap_msgs::msg::Marker> & expected)
+{
+  ASSERT_EQ(markers.size(), expected.size());
+  for (size_t i = 0; i < markers.size(); i++) {
+    EXPECT_EQ(markers[i].subject_name, expected[i].subject_name);
+    EXPECT_EQ(markers[i].marker_name, expected[i].marker_name);
+    EXPECT_EQ(markers[i].segment_name, expected[i].segment_name);
+    EXPECT_EQ(markers[i].translation.x, expected[i].translation.x);
+    EXPECT_EQ(markers[i].translation.y, expected[i].translation.y);
+    EXPECT_EQ(markers[i].translation.z, expected[i].translation.z);
+    EXPECT_EQ(markers[i].occluded, expected[i].occluded);
+  }
+}
+
+TEST(LabeledMarkerIndexTest, test_same_as_by_name)
+{
+  FakeMarkerClient client(3, 5);
+  LabeledMarkerIndex index;
+
+  for (unsigned int frame = 0; frame < 10; frame++) {
+    client.move(frame);
+    std::vector<mocap_msgs::msg::Marker> markers, expected;
+    bool by_index = index.read(client, markers);
+    EXPECT_EQ(by_index, frame > 0);
+    LabeledMarkerIndex::read_by_name(client, expected);
+    expect_same_markers(markers, expected);
+  }
+  EXPECT_EQ(index.resolutions(), 1u);
+}
+
+TEST(LabeledMarkerIndexTest, test_occlusion)
+{
+  FakeMarkerClient client(2, 4);
+  LabeledMarkerIndex index;
+  std::vector<mocap_msgs::msg::Marker> markers, expected;
+
+  // Occluded while resolving: its id is bound the first frame it is seen
+  client.subjects[1].markers[2].occluded = true;
+  client.move(0);
+  index.read(client, markers);
+  client.move(1);
+  markers.clear();
+  EXPECT_TRUE(index.read(client, markers));
+  LabeledMarkerIndex::read_by_name(client, expected);
+  expect_same_markers(markers, expected);
+  EXPECT_TRUE(markers[6].occluded);
+
+  client.subjects[1].markers[2].occluded = false;
+  client.subjects[0].markers[0].occluded = true;
+  client.move(2);
+  markers.clear();
+  expected.clear();
+  EXPECT_FALSE(index.read(client, markers));
+  LabeledMarkerIndex::read_by_name(client, expected);
+  expect_same_markers(markers, expected);
+
+  client.move(3);
+  markers.clear();
+  expected.clear();
+  EXPECT_TRUE(index.read(client, markers));
+  LabeledMarkerIndex::read_by_name(client, expected);
+  expect_same_markers(markers, expected);
+  EXPECT_EQ(index.resolutions(), 2u);
+}
+
+TEST(LabeledMarkerIndexTest, test_topology_change)
+{
+  FakeMarkerClient client(2, 4);
+  LabeledMarkerIndex index;
+  std::vector<mocap_msgs::msg::Marker> markers;
+  client.move(0);
+  index.read(client, markers);
+
+  // A new marker in a subject
+  FakeMarkerClient::Marker marker = client.subjects[0].markers.back();
+  marker.name = "marker_new";
+  marker.id = 100;
+  client.subjects[0].markers.push_back(marker);
+  client.move(1);
+  markers.clear();
+  EXPECT_FALSE(index.read(client, markers));
+  EXPECT_EQ(markers.size(), 9u);
+
+  client.move(2);
+  std::vector<mocap_msgs::msg::Marker> expected;
+  markers.clear();
+  EXPECT_TRUE(index.read(client, markers));
+  LabeledMarkerIndex::read_by_name(client, expected);
+  expect_same_markers(markers, expected);
+}
+
+TEST(LabeledMarkerIndexTest, test_bind_tolerance)
+{
+  FakeMarkerClient client(2, 4);
+  LabeledMarkerIndex index;
+  std::vector<mocap_msgs::msg::Marker> markers;
+
+  // Not the same doubles, but the same markers
+  client.labeled_offset = 1e-9;
+  client.move(0);
+  EXPECT_FALSE(index.read(client, markers));
+  EXPECT_EQ(index.unbound(), 0u);
+  client.move(1);
+  markers.clear();
+  EXPECT_TRUE(index.read(client, markers));
+  EXPECT_EQ(index.resolutions(), 1u);
+
+  // Too far to be bound: every frame is read by name, without resolving again
+  index.reset();
+  client.labeled_offset = 1e-3;
+  for (unsigned int frame = 2; frame < 5; frame++) {
+    client.move(frame);
+    std::vector<mocap_msgs::msg::Marker> expected;
+    markers.clear();
+    EXPECT_FALSE(index.read(client, markers));
+    EXPECT_EQ(index.unbound(), 8u);
+    LabeledMarkerIndex::read_by_name(client, expected);
+    expect_same_markers(markers, expected);
+  }
+  EXPECT_EQ(index.resolutions(), 2u);
+  EXPECT_FALSE(index.bind(client));
+
+  // Resolved again when the topology changes
+  client.labeled_offset = 0.0;
+  client.subjects.pop_back();
+  client.move(5);
+  markers.clear();
+  EXPECT_FALSE(index.read(client, markers));
+  EXPECT_EQ(index.unbound(), 0u);
+  EXPECT_EQ(index.resolutions(), 3u);
+  client.move(6);
+  markers.clear();
+  EXPECT_TRUE(index.read(client, markers));
+}
+
+TEST(LabeledMarkerIndexTest, test_slots)
+{
+  FakeMarkerClient client(2, 3);
+  LabeledMarkerIndex index;
+  client.subjects[1].markers[0].occluded = true;
+  client.move(0);
+  EXPECT_FALSE(index.bind(client));
+  EXPECT_TRUE(index.bind(client));
+  EXPECT_EQ(index.size(), 6u);
+  EXPECT_EQ(index.slot(client.subjects[0].markers[2].id), 2);
+  EXPECT_EQ(index.slot(client.subjects[1].markers[2].id), 5);
+
+  // Seen for the first time: not bound until the next bind()
+  EXPECT_EQ(index.slot(client.subjects[1].markers[0].id), -1);
+  client.subjects[1].markers[0].occluded = false;
+  client.move(1);
+  EXPECT_FALSE(index.bind(client));
+  EXPECT_EQ(index.slot(client.subjects[1].markers[0].id), 3);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
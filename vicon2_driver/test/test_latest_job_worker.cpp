@@ -0,0 +1,78 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/latest_job_worker.hpp"
+
+TEST(LatestJobWorkerTest, test_process)
+{
+  std::atomic<int> sum(0);
+  LatestJobWorker<int> worker([&sum](int & job) {sum += job;});
+  worker.start();
+
+  EXPECT_TRUE(worker.post(std::make_unique<int>(3)));
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (worker.processed() < 1 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(worker.processed(), 1u);
+  EXPECT_EQ(sum, 3);
+  worker.stop();
+}
+
+TEST(LatestJobWorkerTest, test_latest_wins)
+{
+  std::atomic<bool> started(false);
+  std::atomic<bool> release(false);
+  std::atomic<int> last(0);
+  LatestJobWorker<int> worker(
+    [&](int & job) {
+      started = true;
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      last = job;
+    });
+  worker.start();
+
+  // The first job blocks the worker, the next ones replace each other while waiting
+  worker.post(std::make_unique<int>(1));
+  while (!started) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(worker.post(std::make_unique<int>(2)));
+  EXPECT_FALSE(worker.post(std::make_unique<int>(3)));
+  EXPECT_EQ(worker.dropped(), 1u);
+
+  release = true;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (worker.processed() < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(worker.processed(), 2u);
+  EXPECT_EQ(last, 3);
+  worker.stop();
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
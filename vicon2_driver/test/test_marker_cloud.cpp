@@ -0,0 +1,62 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/marker_cloud.hpp"
+
+TEST(MarkerCloudTest, test_points)
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  init_marker_cloud(cloud, 2);
+  ASSERT_EQ(cloud.fields.size(), 5u);
+  EXPECT_EQ(cloud.fields[3].name, "label");
+  EXPECT_EQ(cloud.width, 2u);
+  EXPECT_EQ(cloud.data.size(), 2u * cloud.point_step);
+
+  const double translation[3] = {1500.0, -250.0, 10.0};
+  set_marker_point(cloud, 0, translation, 7, false);
+  set_marker_point(cloud, 1, translation, -1, true);
+
+  float xyz[3];
+  int32_t label;
+  std::memcpy(xyz, cloud.data.data(), sizeof(xyz));
+  std::memcpy(&label, cloud.data.data() + cloud.fields[3].offset, sizeof(label));
+  EXPECT_FLOAT_EQ(xyz[0], 1.5f);
+  EXPECT_FLOAT_EQ(xyz[1], -0.25f);
+  EXPECT_FLOAT_EQ(xyz[2], 0.01f);
+  EXPECT_EQ(label, 7);
+  EXPECT_EQ(cloud.data[cloud.fields[4].offset], 0);
+
+  const uint8_t * point = cloud.data.data() + cloud.point_step;
+  std::memcpy(xyz, point, sizeof(xyz));
+  std::memcpy(&label, point + cloud.fields[3].offset, sizeof(label));
+  EXPECT_TRUE(std::isnan(xyz[0]));
+  EXPECT_EQ(label, -1);
+  EXPECT_EQ(point[cloud.fields[4].offset], 1);
+
+  // Fields are kept when resized
+  init_marker_cloud(cloud, 5);
+  EXPECT_EQ(cloud.fields.size(), 5u);
+  EXPECT_EQ(cloud.row_step, 5u * cloud.point_step);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,196 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/marker_cluster.hpp"
+#include "vicon2_driver/quaternion_utils.hpp"
+
+// Asymmetric 4 marker cluster, in mm in its body frame
+static const std::vector<double> kModel = {
+  0.0, 0.0, 0.0, 120.0, 0.0, 0.0, 0.0, 80.0, 0.0, 30.0, 40.0, 60.0};
+
+// The markers of the model at the pose (position in mm, orientation x, y, z, w)
+static std::vector<double> place(
+  const std::vector<double> & model, const double position[3], const double orientation[4])
+{
+  std::vector<double> positions;
+  double conjugate[4];
+  quaternion_conjugate(orientation, conjugate);
+  for (size_t i = 0; i < model.size() / 3; i++) {
+    double point[4] = {model[i * 3], model[i * 3 + 1], model[i * 3 + 2], 0.0};
+    double rotated[4];
+    quaternion_multiply(orientation, point, rotated);
+    quaternion_multiply(rotated, conjugate, rotated);
+    for (int k = 0; k < 3; k++) {
+      positions.push_back(rotated[k] + position[k]);
+    }
+  }
+  return positions;
+}
+
+TEST(MarkerClusterTest, test_solve_rigid_transform)
+{
+  const double position[3] = {1000.0, -250.0, 800.0};
+  double orientation[4];
+  const double rotation[3] = {0.3, -1.2, 2.0};
+  rotation_vector_to_quaternion(rotation, orientation);
+  std::vector<double> observed = place(kModel, position, orientation);
+
+  double solved_position[3], solved_orientation[4], residual;
+  ASSERT_TRUE(
+    solve_rigid_transform(
+      kModel.data(), observed.data(), 4, solved_position, solved_orientation, residual));
+  for (int k = 0; k < 3; k++) {
+    EXPECT_NEAR(solved_position[k], position[k], 1e-6);
+  }
+  double delta[3];
+  quaternion_delta(orientation, solved_orientation, delta);
+  EXPECT_NEAR(
+    std::sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]), 0.0, 1e-9);
+  EXPECT_NEAR(residual, 0.0, 1e-6);
+
+  // A marker off by 4 mm
+  observed[5] += 4.0;
+  ASSERT_TRUE(
+    solve_rigid_transform(
+      kModel.data(), observed.data(), 4, solved_position, solved_orientation, residual));
+  EXPECT_GT(residual, 1.0);
+  EXPECT_LT(residual, 4.0);
+
+  // Collinear markers
+  const std::vector<double> line = {0.0, 0.0, 0.0, 100.0, 0.0, 0.0, 200.0, 0.0, 0.0};
+  EXPECT_FALSE(
+    solve_rigid_transform(
+      line.data(), line.data(), 3, solved_position, solved_orientation, residual));
+}
+
+TEST(MarkerClusterTest, test_labeled)
+{
+  MarkerCluster cluster;
+  std::string error;
+  EXPECT_FALSE(cluster.configure("bad", {"s/a", "s/b"}, {}, 5.0, error));
+  EXPECT_FALSE(error.empty());
+  ASSERT_TRUE(cluster.configure("wand", {"s/a", "s/b", "s/c", "s/d"}, {}, 5.0, error));
+
+  // The model is taken from the first frame with all the markers seen
+  const double identity[4] = {0.0, 0.0, 0.0, 1.0};
+  const double start[3] = {100.0, 200.0, 300.0};
+  std::vector<double> positions = place(kModel, start, identity);
+  bool seen[4] = {true, true, false, true};
+  EXPECT_FALSE(cluster.solve_labeled(positions.data(), seen));
+  seen[2] = true;
+  ASSERT_TRUE(cluster.solve_labeled(positions.data(), seen));
+  // Origin at the center of the markers
+  EXPECT_NEAR(cluster.position()[0], 137.5, 1e-6);
+  EXPECT_NEAR(cluster.position()[1], 230.0, 1e-6);
+  EXPECT_NEAR(cluster.position()[2], 315.0, 1e-6);
+
+  // Moved, with one marker occluded
+  double orientation[4];
+  const double rotation[3] = {0.0, 0.0, M_PI / 2};
+  rotation_vector_to_quaternion(rotation, orientation);
+  const double moved[3] = {500.0, 0.0, 0.0};
+  positions = place(kModel, moved, orientation);
+  seen[1] = false;
+  ASSERT_TRUE(cluster.solve_labeled(positions.data(), seen));
+  EXPECT_EQ(cluster.used(), 3u);
+  EXPECT_NEAR(cluster.orientation()[2], orientation[2], 1e-9);
+  EXPECT_NEAR(cluster.orientation()[3], orientation[3], 1e-9);
+  EXPECT_NEAR(cluster.residual(), 0.0, 1e-6);
+
+  // Two markers left
+  seen[0] = false;
+  EXPECT_FALSE(cluster.solve_labeled(positions.data(), seen));
+  EXPECT_FALSE(cluster.solved());
+}
+
+TEST(MarkerClusterTest, test_unlabeled)
+{
+  MarkerCluster cluster;
+  std::string error;
+  EXPECT_FALSE(cluster.configure("bad", {}, {}, 5.0, error));
+  ASSERT_TRUE(cluster.configure("wand", {}, kModel, 5.0, error));
+
+  // The cluster among random markers, in a different order every frame
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> volume(-2000.0, 2000.0);
+  std::normal_distribution<double> noise(0.0, 0.3);
+  std::vector<double> others(3 * 100);
+  for (double & value : others) {
+    value = volume(generator);
+  }
+  std::vector<uint32_t> ids(104);
+
+  for (int frame = 0; frame < 100; frame++) {
+    double t = frame / 100.0;
+    const double position[3] = {500.0 * t, 200.0, 1000.0};
+    const double rotation[3] = {0.0, t, 2.0 * t};
+    double orientation[4];
+    rotation_vector_to_quaternion(rotation, orientation);
+    std::vector<double> markers = place(kModel, position, orientation);
+    // The first marker is occluded for a while
+    size_t n_cluster = frame >= 40 && frame < 60 ? 3 : 4;
+    if (n_cluster == 3) {
+      markers.erase(markers.begin(), markers.begin() + 3);
+    }
+    std::vector<double> positions = others;
+    size_t insert_at = 3 * (frame % 50);
+    positions.insert(positions.begin() + insert_at, markers.begin(), markers.end());
+    for (double & value : positions) {
+      value += noise(generator);
+    }
+    // Ids as MarkerTracker gives them: the same per physical marker
+    size_t n = positions.size() / 3;
+    for (size_t j = 0; j < n; j++) {
+      size_t i = j * 3;
+      if (i >= insert_at && i < insert_at + markers.size()) {
+        ids[j] = 1000 + (i - insert_at) / 3 + (4 - n_cluster) + (frame >= 60 ? 10 : 0);
+      } else {
+        ids[j] = (i < insert_at ? i : i - markers.size()) / 3;
+      }
+    }
+
+    ASSERT_TRUE(cluster.solve_unlabeled(positions.data(), ids.data(), n)) << "frame " << frame;
+    EXPECT_EQ(cluster.used(), n_cluster);
+    for (int k = 0; k < 3; k++) {
+      EXPECT_NEAR(cluster.position()[k], position[k], 2.0) << "frame " << frame;
+    }
+    double delta[3];
+    quaternion_delta(orientation, cluster.orientation(), delta);
+    EXPECT_LT(std::sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]), 0.02);
+    EXPECT_LT(cluster.residual(), 2.0);
+  }
+
+  // Lost and found again without ids
+  cluster.reset();
+  const double position[3] = {-300.0, 0.0, 500.0};
+  const double identity[4] = {0.0, 0.0, 0.0, 1.0};
+  std::vector<double> positions = place(kModel, position, identity);
+  positions.insert(positions.begin(), others.begin(), others.end());
+  ASSERT_TRUE(cluster.solve_unlabeled(positions.data(), nullptr, positions.size() / 3));
+  EXPECT_NEAR(cluster.position()[0], -300.0, 1e-6);
+  EXPECT_NEAR(cluster.residual(), 0.0, 1e-6);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
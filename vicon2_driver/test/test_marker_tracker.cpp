@@ -0,0 +1,134 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/marker_tracker.hpp"
+
+// Markers on a 100 mm grid moving at 1 m/s, given in a different order every frame
+class MovingMarkers
+{
+public:
+  explicit MovingMarkers(size_t n)
+  : order(n), generator(42)
+  {
+    for (size_t i = 0; i < n; i++) {
+      order[i] = i;
+    }
+  }
+
+  // Positions in mm of the frame at time t, order[i] is the marker at position i
+  std::vector<double> frame(double t)
+  {
+    std::shuffle(order.begin(), order.end(), generator);
+    std::vector<double> positions;
+    for (size_t marker : order) {
+      positions.push_back(100.0 * (marker % 10) + 1000.0 * t);
+      positions.push_back(100.0 * (marker / 10));
+      positions.push_back(500.0 + 10.0 * std::sin(t + marker));
+    }
+    return positions;
+  }
+
+  std::vector<size_t> order;
+  std::mt19937 generator;
+};
+
+TEST(MarkerTrackerTest, test_persistent_ids)
+{
+  MarkerTracker tracker;
+  tracker.configure(20.0, 5);
+  MovingMarkers markers(50);
+  std::vector<uint32_t> ids;
+  std::map<size_t, uint32_t> marker_ids;
+
+  for (int frame = 0; frame < 200; frame++) {
+    double t = frame / 200.0;
+    std::vector<double> positions = markers.frame(t);
+    tracker.update(t, positions.data(), markers.order.size(), ids);
+    ASSERT_EQ(ids.size(), markers.order.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+      size_t marker = markers.order[i];
+      if (frame == 0) {
+        marker_ids[marker] = ids[i];
+      } else {
+        EXPECT_EQ(ids[i], marker_ids[marker]) << "frame " << frame << " marker " << marker;
+      }
+    }
+  }
+  EXPECT_EQ(tracker.track_count(), 50u);
+  EXPECT_EQ(tracker.started(), 50u);
+}
+
+TEST(MarkerTrackerTest, test_missed_frames)
+{
+  MarkerTracker tracker;
+  tracker.configure(20.0, 2);
+  std::vector<uint32_t> ids;
+  const double both[6] = {0.0, 0.0, 0.0, 100.0, 0.0, 0.0};
+  const double second[3] = {100.0, 0.0, 0.0};
+  const double first[3] = {1.0, 0.0, 0.0};
+
+  tracker.update(0.0, both, 2, ids);
+  EXPECT_EQ(ids, std::vector<uint32_t>({0, 1}));
+
+  // The first marker is missing for two frames, it keeps its id
+  tracker.update(0.01, second, 1, ids);
+  EXPECT_EQ(ids, std::vector<uint32_t>({1}));
+  tracker.update(0.02, second, 1, ids);
+  tracker.update(0.03, first, 1, ids);
+  EXPECT_EQ(ids, std::vector<uint32_t>({0}));
+
+  // The second one is missing for more, it gets a new id
+  for (int frame = 4; frame < 8; frame++) {
+    tracker.update(frame * 0.01, first, 1, ids);
+  }
+  tracker.update(0.08, both, 2, ids);
+  EXPECT_EQ(ids, std::vector<uint32_t>({0, 2}));
+  EXPECT_EQ(tracker.started(), 3u);
+
+  // Beyond the gate it is a new marker
+  const double far[3] = {50.0, 0.0, 0.0};
+  tracker.update(0.09, far, 1, ids);
+  EXPECT_EQ(ids, std::vector<uint32_t>({3}));
+
+  tracker.reset();
+  EXPECT_EQ(tracker.track_count(), 0u);
+}
+
+TEST(MarkerTrackerTest, test_closest_first)
+{
+  // Two tracks close to each other: each marker keeps the closest one even when it is the
+  // second candidate of the other marker
+  MarkerTracker tracker;
+  tracker.configure(20.0, 5);
+  std::vector<uint32_t> ids;
+  const double start[6] = {0.0, 0.0, 0.0, 10.0, 0.0, 0.0};
+  tracker.update(0.0, start, 2, ids);
+  const double next[6] = {9.0, 0.0, 0.0, 3.0, 0.0, 0.0};
+  tracker.update(0.005, next, 2, ids);
+  EXPECT_EQ(ids, std::vector<uint32_t>({1, 0}));
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/pose_extrapolator.hpp"
+
+// Rotation of angle rad around z
+void yaw_quaternion(double angle, double q[4])
+{
+  q[0] = 0.0;
+  q[1] = 0.0;
+  q[2] = std::sin(angle / 2.0);
+  q[3] = std::cos(angle / 2.0);
+}
+
+TEST(PoseExtrapolatorTest, test_constant_velocity)
+{
+  PoseExtrapolator extrapolator;
+  double position[3], orientation[4];
+  EXPECT_FALSE(extrapolator.has_pose());
+
+  // 1 m/s along x and 0.5 rad/s around z, at 100 Hz
+  for (int i = 0; i < 5; i++) {
+    double t = 10.0 + 0.01 * i;
+    const double p[3] = {0.01 * i, 2.0, 0.5};
+    double q[4];
+    yaw_quaternion(0.005 * i, q);
+    extrapolator.update(t, p, q);
+    if (i == 0) {
+      EXPECT_FALSE(extrapolator.predict(t + 0.01, 0.1, position, orientation));
+    }
+  }
+
+  ASSERT_TRUE(extrapolator.predict(10.07, 0.1, position, orientation));
+  EXPECT_NEAR(position[0], 0.07, 1e-9);
+  EXPECT_NEAR(position[1], 2.0, 1e-9);
+  EXPECT_NEAR(position[2], 0.5, 1e-9);
+  double expected[4];
+  yaw_quaternion(0.035, expected);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_NEAR(orientation[i], expected[i], 1e-9);
+  }
+}
+
+TEST(PoseExtrapolatorTest, test_max_gap)
+{
+  PoseExtrapolator extrapolator;
+  const double p[3] = {0.0, 0.0, 0.0};
+  const double q[4] = {0.0, 0.0, 0.0, 1.0};
+  double position[3], orientation[4];
+  extrapolator.update(1.0, p, q);
+  extrapolator.update(1.01, p, q);
+
+  EXPECT_TRUE(extrapolator.predict(1.05, 0.05, position, orientation));
+  EXPECT_FALSE(extrapolator.predict(1.07, 0.05, position, orientation));
+  EXPECT_FALSE(extrapolator.predict(1.0, 0.05, position, orientation));
+
+  extrapolator.reset();
+  EXPECT_FALSE(extrapolator.has_pose());
+  EXPECT_FALSE(extrapolator.predict(1.02, 0.05, position, orientation));
+}
+
+TEST(PoseExtrapolatorTest, test_shortest_rotation)
+{
+  // The same orientation with opposite signs is no rotation
+  PoseExtrapolator extrapolator;
+  const double p[3] = {0.0, 0.0, 0.0};
+  double q[4];
+  yaw_quaternion(0.3, q);
+  extrapolator.update(0.0, p, q);
+  for (int i = 0; i < 4; i++) {
+    q[i] = -q[i];
+  }
+  extrapolator.update(0.01, p, q);
+
+  double position[3], orientation[4];
+  ASSERT_TRUE(extrapolator.predict(0.02, 0.1, position, orientation));
+  double expected[4];
+  yaw_quaternion(0.3, expected);
+  double dot = 0.0;
+  for (int i = 0; i < 4; i++) {
+    dot += orientation[i] * expected[i];
+  }
+  EXPECT_NEAR(std::fabs(dot), 1.0, 1e-9);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/pose_jump_filter.hpp"
+
+TEST(PoseJumpFilterTest, test_sign_continuity)
+{
+  PoseJumpFilter filter;
+  filter.configure(10.0, 30.0, 10);
+  size_t body = filter.add_body();
+  const double position[3] = {1.0, 2.0, 3.0};
+  double orientation[4] = {0.0, 0.0, std::sin(0.1), std::cos(0.1)};
+  EXPECT_EQ(filter.filter(body, 0.0, position, orientation), PoseJumpFilter::ACCEPTED);
+
+  // The same rotation with the other sign is given back with the previous sign
+  double flipped[4] = {0.0, 0.0, -std::sin(0.1), -std::cos(0.1)};
+  EXPECT_EQ(filter.filter(body, 0.01, position, flipped), PoseJumpFilter::FLIPPED);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_DOUBLE_EQ(flipped[i], orientation[i]);
+  }
+  EXPECT_EQ(filter.flipped(), 1u);
+  EXPECT_EQ(filter.rejected(), 0u);
+}
+
+TEST(PoseJumpFilterTest, test_jumps)
+{
+  PoseJumpFilter filter;
+  filter.configure(10.0, 30.0, 3);
+  size_t body = filter.add_body();
+  double position[3] = {0.0, 0.0, 0.0};
+  double identity[4] = {0.0, 0.0, 0.0, 1.0};
+  EXPECT_EQ(filter.filter(body, 0.0, position, identity), PoseJumpFilter::ACCEPTED);
+
+  // 5 cm in 10 ms is 5 m/s, 20 cm is 20 m/s
+  position[0] = 0.05;
+  EXPECT_EQ(filter.filter(body, 0.01, position, identity), PoseJumpFilter::ACCEPTED);
+  position[0] = 0.25;
+  EXPECT_EQ(filter.filter(body, 0.02, position, identity), PoseJumpFilter::REJECTED);
+  // After an occlusion the same distance is allowed
+  EXPECT_EQ(filter.filter(body, 0.04, position, identity), PoseJumpFilter::ACCEPTED);
+
+  // A single frame half turn is rejected
+  double turned[4] = {0.0, 0.0, 1.0, 0.0};
+  EXPECT_EQ(filter.filter(body, 0.05, position, turned), PoseJumpFilter::REJECTED);
+  EXPECT_EQ(filter.rejected(), 2u);
+
+  // Until it lasts for more than max_rejected frames
+  double t = 0.05;
+  for (int i = 0; i < 2; i++) {
+    t += 0.01;
+    EXPECT_EQ(filter.filter(body, t, position, turned), PoseJumpFilter::REJECTED);
+  }
+  EXPECT_EQ(filter.filter(body, t + 0.01, position, turned), PoseJumpFilter::ACCEPTED);
+  EXPECT_EQ(filter.rejected(), 4u);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
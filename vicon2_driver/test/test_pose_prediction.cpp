@@ -0,0 +1,96 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/pose_prediction.hpp"
+
+TEST(PosePredictionTest, test_predict_pose)
+{
+  // Quarter turn around x in 0.5 s from a half turn around z, moving along y
+  const double position[3] = {1.0, 2.0, 3.0};
+  const double orientation[4] = {0.0, 0.0, 1.0, 0.0};
+  const double linear[3] = {0.0, 0.4, 0.0};
+  const double angular[3] = {M_PI, 0.0, 0.0};
+  double predicted_position[3], predicted_orientation[4];
+  predict_pose(
+    position, orientation, linear, angular, 0.5, predicted_position, predicted_orientation);
+
+  EXPECT_NEAR(predicted_position[0], 1.0, 1e-12);
+  EXPECT_NEAR(predicted_position[1], 2.2, 1e-12);
+  EXPECT_NEAR(predicted_position[2], 3.0, 1e-12);
+  // (sin(pi/4), 0, 0, cos(pi/4)) * (0, 0, 1, 0)
+  double h = std::sqrt(0.5);
+  EXPECT_NEAR(predicted_orientation[0], 0.0, 1e-12);
+  EXPECT_NEAR(predicted_orientation[1], -h, 1e-12);
+  EXPECT_NEAR(predicted_orientation[2], h, 1e-12);
+  EXPECT_NEAR(predicted_orientation[3], 0.0, 1e-12);
+
+  // Many small steps give the same orientation
+  double step_orientation[4] = {0.0, 0.0, 1.0, 0.0};
+  double step_position[3] = {1.0, 2.0, 3.0};
+  for (int i = 0; i < 100; i++) {
+    predict_pose(
+      step_position, step_orientation, linear, angular, 0.005, step_position, step_orientation);
+  }
+  for (int i = 0; i < 4; i++) {
+    EXPECT_NEAR(step_orientation[i], predicted_orientation[i], 1e-9);
+  }
+}
+
+TEST(PosePredictionTest, test_evaluator)
+{
+  PredictionEvaluator evaluator(4);
+  const double origin[3] = {0.0, 0.0, 0.0};
+  const double identity[4] = {0.0, 0.0, 0.0, 1.0};
+  const double position[3] = {0.1, 0.0, 0.0};
+  const double yaw[4] = {0.0, 0.0, std::sin(0.05), std::cos(0.05)};
+  PredictionError error;
+
+  evaluator.add(1.0, position, identity, origin, identity);
+  evaluator.add(1.01, position, identity, origin, identity);
+  EXPECT_EQ(evaluator.pending(), 2u);
+
+  // Nothing for this time yet
+  EXPECT_FALSE(evaluator.observe(0.99, 0.004, position, identity, error));
+  EXPECT_EQ(evaluator.pending(), 2u);
+
+  ASSERT_TRUE(evaluator.observe(1.001, 0.004, position, yaw, error));
+  EXPECT_NEAR(error.position, 0.0, 1e-12);
+  EXPECT_NEAR(error.orientation, 0.1, 1e-9);
+  EXPECT_NEAR(error.last_position, 0.1, 1e-12);
+  EXPECT_NEAR(error.last_orientation, 0.1, 1e-9);
+
+  // The prediction for 1.01 is skipped by a later frame
+  EXPECT_FALSE(evaluator.observe(1.02, 0.004, position, identity, error));
+  EXPECT_EQ(evaluator.pending(), 0u);
+
+  // The oldest are discarded beyond max_pending
+  for (int i = 0; i < 6; i++) {
+    evaluator.add(2.0 + i, position, identity, origin, identity);
+  }
+  EXPECT_EQ(evaluator.pending(), 4u);
+  EXPECT_FALSE(evaluator.observe(2.0, 0.004, position, identity, error));
+  EXPECT_TRUE(evaluator.observe(4.0, 0.004, position, identity, error));
+  evaluator.clear();
+  EXPECT_EQ(evaluator.pending(), 0u);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sched.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/realtime_utils.hpp"
+
+TEST(RealtimeUtilsTest, test_jitter_stats)
+{
+  JitterStats stats;
+  EXPECT_EQ(stats.count(), 0u);
+  EXPECT_DOUBLE_EQ(stats.mean(), 0.0);
+  EXPECT_DOUBLE_EQ(stats.stddev(), 0.0);
+
+  stats.add(0.001);
+  stats.add(-0.003);
+  stats.add(0.002);
+
+  EXPECT_EQ(stats.count(), 3u);
+  EXPECT_NEAR(stats.mean(), 0.0, 1e-12);
+  EXPECT_NEAR(stats.stddev(), 0.0021602, 1e-6);
+  EXPECT_DOUBLE_EQ(stats.max_abs(), 0.003);
+
+  stats.reset();
+  EXPECT_EQ(stats.count(), 0u);
+  EXPECT_DOUBLE_EQ(stats.max_abs(), 0.0);
+}
+
+TEST(RealtimeUtilsTest, test_cpu_affinity)
+{
+  // The first CPU the test may run on, which needs not be CPU 0 (e.g. in a container)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set_t), &allowed), 0);
+  int64_t cpu = 0;
+  while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &allowed)) {
+    cpu++;
+  }
+  ASSERT_LT(cpu, CPU_SETSIZE);
+
+  std::string error;
+  EXPECT_TRUE(set_thread_cpu_affinity({cpu}, error)) << error;
+  cpu_set_t pinned;
+  CPU_ZERO(&pinned);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set_t), &pinned), 0);
+  EXPECT_EQ(CPU_COUNT(&pinned), 1);
+  EXPECT_TRUE(CPU_ISSET(cpu, &pinned));
+
+  EXPECT_FALSE(set_thread_cpu_affinity({-1}, error));
+  EXPECT_EQ(error, "invalid CPU id -1");
+  EXPECT_FALSE(set_thread_cpu_affinity({CPU_SETSIZE}, error));
+
+  // Back to the CPUs it had
+  sched_setaffinity(0, sizeof(cpu_set_t), &allowed);
+}
+
+TEST(RealtimeUtilsTest, test_cpu_list_to_string)
+{
+  EXPECT_EQ(cpu_list_to_string({}), "");
+  EXPECT_EQ(cpu_list_to_string({3}), "3");
+  EXPECT_EQ(cpu_list_to_string({0, 2, 35}), "0,2,35");
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
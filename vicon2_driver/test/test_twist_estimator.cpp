@@ -0,0 +1,145 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/twist_estimator.hpp"
+
+// Pose at time t of a body moving at 1 m/s along x with 0.5 m/s^2 along y and turning at
+// 2 rad/s around z
+void body_pose(double t, double position[3], double orientation[4])
+{
+  position[0] = 1.0 + t;
+  position[1] = 0.25 * t * t;
+  position[2] = 0.5;
+  orientation[0] = 0.0;
+  orientation[1] = 0.0;
+  orientation[2] = std::sin(t);
+  orientation[3] = std::cos(t);
+}
+
+void check_twist(const TwistEstimator & estimator, size_t body, double t, double tolerance)
+{
+  double linear[3], angular[3], variance[6];
+  ASSERT_TRUE(estimator.twist(body, linear, angular, variance));
+  EXPECT_NEAR(linear[0], 1.0, tolerance);
+  EXPECT_NEAR(linear[1], 0.5 * t, tolerance);
+  EXPECT_NEAR(linear[2], 0.0, tolerance);
+  EXPECT_NEAR(angular[0], 0.0, tolerance);
+  EXPECT_NEAR(angular[1], 0.0, tolerance);
+  EXPECT_NEAR(angular[2], 2.0, tolerance);
+  for (int i = 0; i < 6; i++) {
+    EXPECT_GT(variance[i], 0.0);
+  }
+}
+
+TEST(TwistEstimatorTest, test_parse_method)
+{
+  TwistEstimator::Method method;
+  EXPECT_TRUE(TwistEstimator::parse_method("kalman", method));
+  EXPECT_EQ(method, TwistEstimator::KALMAN);
+  EXPECT_TRUE(TwistEstimator::parse_method("savitzky_golay", method));
+  EXPECT_EQ(method, TwistEstimator::SAVITZKY_GOLAY);
+  EXPECT_FALSE(TwistEstimator::parse_method("none", method));
+}
+
+TEST(TwistEstimatorTest, test_savitzky_golay)
+{
+  // A quadratic fit is exact for this motion, also with dropped frames
+  TwistEstimator estimator;
+  estimator.configure(TwistEstimator::SAVITZKY_GOLAY, 7, 50.0, 1e-6, 0.25);
+  size_t body = estimator.add_body();
+  double position[3], orientation[4];
+  double linear[3], angular[3], variance[6];
+
+  double t = 0.0;
+  for (int frame = 0; frame < 50; frame++) {
+    t = 0.01 * frame;
+    if (frame % 7 == 3) {
+      continue;
+    }
+    body_pose(t, position, orientation);
+    estimator.set_pose(body, position, orientation);
+    estimator.update(t);
+    if (frame == 0) {
+      EXPECT_FALSE(estimator.twist(body, linear, angular, variance));
+    }
+  }
+  check_twist(estimator, body, t, 1e-6);
+}
+
+TEST(TwistEstimatorTest, test_kalman)
+{
+  TwistEstimator estimator;
+  estimator.configure(TwistEstimator::KALMAN, 7, 50.0, 1e-6, 0.25);
+  size_t body = estimator.add_body();
+  double position[3], orientation[4];
+
+  double t = 0.0;
+  for (int frame = 0; frame < 200; frame++) {
+    t = 0.01 * frame;
+    body_pose(t, position, orientation);
+    estimator.set_pose(body, position, orientation);
+    estimator.update(t);
+  }
+  check_twist(estimator, body, t, 1e-3);
+}
+
+TEST(TwistEstimatorTest, test_bodies_and_gaps)
+{
+  TwistEstimator estimator;
+  estimator.configure(TwistEstimator::KALMAN, 7, 50.0, 1e-6, 0.25);
+  size_t moving = estimator.add_body();
+  size_t still = estimator.add_body();
+  EXPECT_EQ(estimator.size(), 2u);
+  double position[3], orientation[4];
+  double linear[3], angular[3], variance[6];
+
+  double t = 0.0;
+  for (int frame = 0; frame < 200; frame++) {
+    t = 0.01 * frame;
+    body_pose(t, position, orientation);
+    estimator.set_pose(moving, position, orientation);
+    // Only seen every other frame
+    if (frame % 2 == 0) {
+      body_pose(0.0, position, orientation);
+      estimator.set_pose(still, position, orientation);
+    }
+    estimator.update(t);
+  }
+  check_twist(estimator, moving, t, 1e-3);
+  ASSERT_TRUE(estimator.twist(still, linear, angular, variance));
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(linear[i], 0.0, 1e-6);
+    EXPECT_NEAR(angular[i], 0.0, 1e-6);
+  }
+
+  // Seen again after more than max_gap, it starts again
+  t += 1.0;
+  body_pose(t, position, orientation);
+  estimator.set_pose(moving, position, orientation);
+  estimator.update(t);
+  EXPECT_FALSE(estimator.twist(moving, linear, angular, variance));
+
+  estimator.clear();
+  EXPECT_EQ(estimator.size(), 0u);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
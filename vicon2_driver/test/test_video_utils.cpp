@@ -0,0 +1,64 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/video_utils.hpp"
+
+using VideoFrame = ViconDataStreamSDK::CPP::Output_GetVideoFrame;
+
+TEST(VideoUtilsTest, test_encodings)
+{
+  EXPECT_EQ(video_format_encoding(VideoFrame::EMono8), "mono8");
+  EXPECT_EQ(video_format_encoding(VideoFrame::EBayerGR8), "bayer_grbg8");
+  EXPECT_EQ(video_format_encoding(VideoFrame::EBGR888), "bgr8");
+  EXPECT_EQ(video_format_encoding(VideoFrame::ENoVideo), "");
+  EXPECT_EQ(video_format_pixel_size(VideoFrame::ERGB888), 3u);
+  EXPECT_EQ(video_format_pixel_size(VideoFrame::ENoVideo), 0u);
+}
+
+TEST(VideoUtilsTest, test_fill_image)
+{
+  VideoFrame frame;
+  frame.m_Width = 4;
+  frame.m_Height = 2;
+  frame.m_Format = VideoFrame::ERGB888;
+  frame.m_Data = std::make_shared<std::vector<unsigned char>>(4 * 2 * 3);
+  for (size_t i = 0; i < frame.m_Data->size(); i++) {
+    (*frame.m_Data)[i] = static_cast<unsigned char>(i);
+  }
+
+  sensor_msgs::msg::Image image;
+  ASSERT_TRUE(fill_image(frame, image));
+  EXPECT_EQ(image.width, 4u);
+  EXPECT_EQ(image.height, 2u);
+  EXPECT_EQ(image.step, 12u);
+  EXPECT_EQ(image.encoding, "rgb8");
+  EXPECT_EQ(image.data, *frame.m_Data);
+
+  // Truncated or missing data
+  frame.m_Data->resize(10);
+  EXPECT_FALSE(fill_image(frame, image));
+  frame.m_Data.reset();
+  EXPECT_FALSE(fill_image(frame, image));
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
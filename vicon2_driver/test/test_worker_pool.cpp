@@ -0,0 +1,86 @@
+// Copyright (c) 2020, Intelligent Robotics Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "vicon2_driver/worker_pool.hpp"
+
+TEST(WorkerPoolTest, test_sequential)
+{
+  WorkerPool pool;
+  std::vector<int> done(10, 0);
+  pool.run(done.size(), [&done](size_t i) {done[i]++;});
+  EXPECT_EQ(pool.size(), 0u);
+  EXPECT_EQ(done, std::vector<int>(10, 1));
+}
+
+TEST(WorkerPoolTest, test_every_item_once_per_run)
+{
+  WorkerPool pool;
+  pool.start(3);
+  EXPECT_EQ(pool.size(), 3u);
+
+  std::vector<std::atomic<int>> done(500);
+  for (auto & count : done) {
+    count = 0;
+  }
+  // Each run must be complete when it returns, before the next one starts
+  for (int frame = 1; frame <= 200; frame++) {
+    pool.run(done.size(), [&done](size_t i) {done[i]++;});
+    for (const auto & count : done) {
+      ASSERT_EQ(count, frame);
+    }
+  }
+  pool.run(0, [&done](size_t i) {done[i]++;});
+
+  pool.stop();
+  EXPECT_EQ(pool.size(), 0u);
+
+  // Restarted after some runs
+  pool.start(2);
+  pool.run(done.size(), [&done](size_t i) {done[i]++;});
+  for (const auto & count : done) {
+    EXPECT_EQ(count, 201);
+  }
+}
+
+TEST(WorkerPoolTest, test_thread_init)
+{
+  WorkerPool pool;
+  std::atomic<int> calls(0);
+  // Every other thread fails to initialize
+  pool.start(3, [&calls]() {return calls++ % 2 == 0;});
+
+  // Every thread has initialized when it takes part in a run
+  std::atomic<int> done(0);
+  pool.run(10, [&done](size_t) {done++;});
+  EXPECT_EQ(done, 10);
+  EXPECT_EQ(calls, 3);
+  EXPECT_EQ(pool.initialized(), 2u);
+
+  pool.stop();
+  EXPECT_EQ(pool.initialized(), 0u);
+  pool.start(2);
+  pool.run(1, [](size_t) {});
+  EXPECT_EQ(pool.initialized(), 2u);
+}
+
+int main(int argc, char * argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}